@@ -0,0 +1,12 @@
+# NOTE: builds the CSG core library first and then the Qt demo and the benchmark that link it
+
+TEMPLATE = subdirs
+
+SUBDIRS += \
+    csg \
+    app \
+    bench
+
+app.file = UntitledTest.pro
+app.depends = csg
+bench.depends = csg
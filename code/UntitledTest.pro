@@ -26,18 +26,30 @@ CONFIG += c++20
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
 SOURCES += \
+    csgworker.cpp \
     main.cpp \
     mainwindow.cpp \
-    mat_h.hpp \
-    mesh.cpp \
     openglrenderwidget.cpp
 
 HEADERS += \
+    csgworker.h \
     mainwindow.h \
-    mat_h.hpp \
-    mesh.h \
     openglrenderwidget.h
 
+# NOTE: the CSG core is the csg static library, CSGDemo.pro builds it before this project
+win32:CONFIG(release, debug|release): LIBS += -L$$OUT_PWD/csg/release/ -lcsg
+else:win32:CONFIG(debug, debug|release): LIBS += -L$$OUT_PWD/csg/debug/ -lcsg
+else:unix: LIBS += -L$$OUT_PWD/csg/ -lcsg
+
+INCLUDEPATH += $$PWD/csg
+DEPENDPATH += $$PWD/csg
+
+win32-g++:CONFIG(release, debug|release): PRE_TARGETDEPS += $$OUT_PWD/csg/release/libcsg.a
+else:win32-g++:CONFIG(debug, debug|release): PRE_TARGETDEPS += $$OUT_PWD/csg/debug/libcsg.a
+else:win32:!win32-g++:CONFIG(release, debug|release): PRE_TARGETDEPS += $$OUT_PWD/csg/release/csg.lib
+else:win32:!win32-g++:CONFIG(debug, debug|release): PRE_TARGETDEPS += $$OUT_PWD/csg/debug/csg.lib
+else:unix: PRE_TARGETDEPS += $$OUT_PWD/csg/libcsg.a
+
 FORMS += \
     mainwindow.ui
 
@@ -0,0 +1,25 @@
+# NOTE: console benchmark of the CSG core, it needs no Qt and no GL context
+
+TEMPLATE = app
+TARGET = csgbench
+
+CONFIG += console c++20
+CONFIG -= qt app_bundle
+
+SOURCES += \
+    csgbench.cpp
+
+win32:CONFIG(release, debug|release): LIBS += -L$$OUT_PWD/../csg/release/ -lcsg
+else:win32:CONFIG(debug, debug|release): LIBS += -L$$OUT_PWD/../csg/debug/ -lcsg
+else:unix: LIBS += -L$$OUT_PWD/../csg/ -lcsg
+
+INCLUDEPATH += $$PWD/../csg
+DEPENDPATH += $$PWD/../csg
+
+win32-g++:CONFIG(release, debug|release): PRE_TARGETDEPS += $$OUT_PWD/../csg/release/libcsg.a
+else:win32-g++:CONFIG(debug, debug|release): PRE_TARGETDEPS += $$OUT_PWD/../csg/debug/libcsg.a
+else:win32:!win32-g++:CONFIG(release, debug|release): PRE_TARGETDEPS += $$OUT_PWD/../csg/release/csg.lib
+else:win32:!win32-g++:CONFIG(debug, debug|release): PRE_TARGETDEPS += $$OUT_PWD/../csg/debug/csg.lib
+else:unix: PRE_TARGETDEPS += $$OUT_PWD/../csg/libcsg.a
+
+unix: LIBS += -lpthread
@@ -0,0 +1,740 @@
+// NOTE: benchmarks of the CSG core without a window or a GL context.
+// Every benchmark runs an input until it had both MinIterations and MinTime,
+// each iteration is timed on its own and the median is the number to track.
+// Output is JSON with a fixed key order, one benchmark per line, so two runs
+// can be diffed and parsed line by line.
+//
+// csgbench [--sectors 8,16,...] [--divisions 1,4,...] [--obj path]... [--filter name]
+//          [--strategy all|random|stratified|axis] [--threads N]
+//          [--min-iterations N] [--min-time-ms N] [--out path]
+
+#include "csg.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+struct bench_config
+{
+    std::vector<int> SectorCounts = {8, 16, 32, 64, 128, 256};
+    std::vector<int> Divisions = {1, 4, 16, 32};
+    std::vector<std::string> ObjPaths;
+    std::string Filter;
+    std::string OutPath;
+
+    bsp_split_strategy Strategy = bsp_split_all;
+    uint32_t ThreadCount = 0;
+    uint32_t MinIterations = 5;
+    double MinTimeMs = 200;
+};
+
+// NOTE: an input mesh with its polygons in world space (Model is identity)
+struct bench_input
+{
+    std::string Kind;
+    std::string Name;
+    int Param = 0;
+    uint64_t FileSize = 0;
+
+    mesh Mesh;
+    polygon_soup Polygons;
+};
+
+// NOTE: the stock benchmarks check their stock once, outside of the timing. Points are
+// sampled in the bounds of the input, a point is in the reference when it is inside of
+// the input and of none of the tool solids. Agreement is the share of the points the stock
+// tree puts on the same side, MeshVolume is the volume Generated encloses. StockDepth is
+// the depth the stock reached and Fallbacks the steps cut at the end pose
+struct bench_check
+{
+    uint32_t Points = 0;
+    double Agreement = 0;
+    double MeshVolume = 0;
+    double SampledVolume = 0;
+    uint32_t StockDepth = 0;
+    uint32_t Fallbacks = 0;
+};
+
+// NOTE: Items is the amount of work done by one iteration (polygons, bytes),
+// Result is a number that only depends on the output, a change of it
+// between two runs means the algorithm behaves differently and not just slower.
+// Stats are the counters of one extra call that is not timed, for the
+// benchmarks of the calls that return them. Quality is the shape of the
+// tree the build benchmark made with the --strategy of the run
+struct bench_result
+{
+    const char* Benchmark;
+    const bench_input* Input;
+
+    uint32_t Iterations = 0;
+    uint64_t MinNs = 0;
+    uint64_t MedianNs = 0;
+    uint64_t MeanNs = 0;
+    uint64_t MaxNs = 0;
+
+    uint64_t Items = 0;
+    const char* ItemName = "polygons";
+    uint64_t Result = 0;
+
+    bool HasStats = false;
+    csg_stats Stats;
+
+    bool HasQuality = false;
+    bsp_tree_quality Quality;
+
+    bool HasCheck = false;
+    bench_check Check;
+};
+
+// NOTE: a solid the stock benchmarks cut away, for the reference of the check
+struct bench_solid
+{
+    bsp_tree Tree;
+    aabb Bounds;
+};
+
+const uint32_t STOCK_STEP_COUNT = 100;
+const uint32_t STOCK_SUBSTEP_COUNT = 8;
+const uint32_t STOCK_CHECK_POINT_COUNT = 100000;
+
+// NOTE: same as CSG_TOOL_MAX_DEPTH of the worker
+const uint32_t STOCK_TOOL_MAX_DEPTH = 256;
+
+static std::vector<int>
+ParseIntList(const char* Text)
+{
+    std::vector<int> Result;
+    while(*Text)
+    {
+        char* End = nullptr;
+        long Value = strtol(Text, &End, 10);
+        if(End == Text) break;
+        Result.push_back((int)Value);
+        Text = (*End == ',') ? End + 1 : End;
+    }
+    return Result;
+}
+
+static bool
+ParseArgs(int ArgCount, char** Args, bench_config& Config)
+{
+    for(int Idx = 1; Idx < ArgCount; ++Idx)
+    {
+        const char* Arg = Args[Idx];
+        const char* Value = (Idx + 1 < ArgCount) ? Args[Idx + 1] : nullptr;
+        if(!Value)
+        {
+            fprintf(stderr, "missing value for %s\n", Arg);
+            return false;
+        }
+
+        if(!strcmp(Arg, "--sectors"))             Config.SectorCounts = ParseIntList(Value);
+        else if(!strcmp(Arg, "--divisions"))      Config.Divisions = ParseIntList(Value);
+        else if(!strcmp(Arg, "--obj"))            Config.ObjPaths.push_back(Value);
+        else if(!strcmp(Arg, "--filter"))         Config.Filter = Value;
+        else if(!strcmp(Arg, "--out"))            Config.OutPath = Value;
+        else if(!strcmp(Arg, "--threads"))        Config.ThreadCount = (uint32_t)atoi(Value);
+        else if(!strcmp(Arg, "--min-iterations")) Config.MinIterations = std::max(1, atoi(Value));
+        else if(!strcmp(Arg, "--min-time-ms"))    Config.MinTimeMs = atof(Value);
+        else if(!strcmp(Arg, "--strategy"))
+        {
+            if(!strcmp(Value, "all"))             Config.Strategy = bsp_split_all;
+            else if(!strcmp(Value, "random"))     Config.Strategy = bsp_split_random;
+            else if(!strcmp(Value, "stratified")) Config.Strategy = bsp_split_stratified;
+            else if(!strcmp(Value, "axis"))       Config.Strategy = bsp_split_axis_aligned;
+            else
+            {
+                fprintf(stderr, "unknown strategy %s\n", Value);
+                return false;
+            }
+        }
+        else
+        {
+            fprintf(stderr, "unknown argument %s\n", Arg);
+            return false;
+        }
+        ++Idx;
+    }
+    return true;
+}
+
+static const char*
+GetStrategyName(bsp_split_strategy Strategy)
+{
+    switch(Strategy)
+    {
+        case bsp_split_all:          return "all";
+        case bsp_split_random:       return "random";
+        case bsp_split_stratified:   return "stratified";
+        case bsp_split_axis_aligned: return "axis";
+    }
+    return "unknown";
+}
+
+static void
+FinishInput(bench_input& Input)
+{
+    Input.Mesh.SetNewTransform(vec3(1), vec3(0), vec3(0));
+    Input.Polygons = Input.Mesh.GeneratePolygons(Input.Mesh.VertexIndices);
+}
+
+// NOTE: writes the mesh as an OBJ with positions, texture coordinates and normals,
+// so LoadMesh goes through all of its paths on a file of a known size
+static uint64_t
+WriteObj(const mesh& Mesh, const std::string& Path)
+{
+    FILE* File = fopen(Path.c_str(), "wb");
+    if(!File) return 0;
+
+    fprintf(File, "# csgbench\no bench\n");
+    for(const vertex& Vertex : Mesh.Vertices)
+        fprintf(File, "v %f %f %f\n", Vertex.Pos.x, Vertex.Pos.y, Vertex.Pos.z);
+    for(const vertex& Vertex : Mesh.Vertices)
+        fprintf(File, "vt %f %f\n", Vertex.Pos.x * 0.5f + 0.5f, Vertex.Pos.y * 0.5f + 0.5f);
+    for(const vertex& Vertex : Mesh.Vertices)
+        fprintf(File, "vn %f %f %f\n", Vertex.Norm.x, Vertex.Norm.y, Vertex.Norm.z);
+    for(size_t Idx = 0; Idx + 2 < Mesh.VertexIndices.size(); Idx += 3)
+    {
+        uint32_t A = Mesh.VertexIndices[Idx] + 1;
+        uint32_t B = Mesh.VertexIndices[Idx + 1] + 1;
+        uint32_t C = Mesh.VertexIndices[Idx + 2] + 1;
+        fprintf(File, "f %u/%u/%u %u/%u/%u %u/%u/%u\n", A, A, A, B, B, B, C, C, C);
+    }
+
+    uint64_t Size = (uint64_t)ftell(File);
+    fclose(File);
+    return Size;
+}
+
+static uint64_t
+GetFileSize(const std::string& Path)
+{
+    std::ifstream File(Path, std::ios::binary | std::ios::ate);
+    return File.is_open() ? (uint64_t)File.tellg() : 0;
+}
+
+static bool
+IsSelected(const bench_config& Config, const char* Benchmark)
+{
+    return Config.Filter.empty() || strstr(Benchmark, Config.Filter.c_str());
+}
+
+// NOTE: Func returns the Result of one iteration, it has to be the same every time
+static bench_result
+RunBenchmark(const bench_config& Config, const char* Benchmark, const bench_input& Input,
+             uint64_t Items, const std::function<uint64_t()>& Func)
+{
+    bench_result Result;
+    Result.Benchmark = Benchmark;
+    Result.Input = &Input;
+    Result.Items = Items;
+
+    // NOTE: the first call is not timed, it warms up the caches and the allocator
+    Result.Result = Func();
+
+    std::vector<uint64_t> Times;
+    double TotalMs = 0;
+    while((Times.size() < Config.MinIterations) || (TotalMs < Config.MinTimeMs))
+    {
+        auto Start = std::chrono::steady_clock::now();
+        uint64_t IterationResult = Func();
+        auto End = std::chrono::steady_clock::now();
+
+        uint64_t Ns = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(End - Start).count();
+        Times.push_back(Ns);
+        TotalMs += Ns / 1e6;
+
+        if(IterationResult != Result.Result)
+            fprintf(stderr, "%s %s %d: result changed between iterations\n", Benchmark, Input.Name.c_str(), Input.Param);
+    }
+
+    std::sort(Times.begin(), Times.end());
+    uint64_t Sum = 0;
+    for(uint64_t Ns : Times) Sum += Ns;
+
+    Result.Iterations = (uint32_t)Times.size();
+    Result.MinNs = Times.front();
+    Result.MedianNs = Times[Times.size() / 2];
+    Result.MeanNs = Sum / Times.size();
+    Result.MaxNs = Times.back();
+
+    fprintf(stderr, "%-18s %-10s %6d %12.3f ms\n", Benchmark, Input.Name.c_str(), Input.Param, Result.MedianNs / 1e6);
+    return Result;
+}
+
+static bench_solid
+GetSolid(const polygon_soup& Polygons, const bsp_build_params& Params)
+{
+    bench_solid Result;
+    Result.Tree = BuildBSPTree(Polygons, Params);
+    Result.Bounds = GetPolygonsAABB(Polygons, 0, Polygons.Size());
+    return Result;
+}
+
+// NOTE: free slots of the stock have no area and add nothing
+static double
+GetMeshVolume(const mesh& Mesh)
+{
+    double Volume = 0;
+    for(size_t Idx = 0; Idx + 2 < Mesh.VertexIndices.size(); Idx += 3)
+    {
+        const v4<float>& A = Mesh.Vertices[Mesh.VertexIndices[Idx + 0]].Pos;
+        const v4<float>& B = Mesh.Vertices[Mesh.VertexIndices[Idx + 1]].Pos;
+        const v4<float>& C = Mesh.Vertices[Mesh.VertexIndices[Idx + 2]].Pos;
+        Volume += (A.x * ((double)B.y * C.z - (double)B.z * C.y) +
+                   A.y * ((double)B.z * C.x - (double)B.x * C.z) +
+                   A.z * ((double)B.x * C.y - (double)B.y * C.x)) / 6.0;
+    }
+    return Volume;
+}
+
+static bench_check
+CheckStock(const bsp_stock& Stock, const bsp_tree& Source, const std::vector<bench_solid>& Removed, aabb Bounds)
+{
+    bench_check Check;
+    Check.Points = STOCK_CHECK_POINT_COUNT;
+    Check.MeshVolume = GetMeshVolume(Stock.Generated);
+    Check.StockDepth = BSPGetTreeQuality(Stock.Tree).MaxDepth;
+
+    std::minstd_rand Random(1);
+    std::uniform_real_distribution<float> Unit(0.0f, 1.0f);
+    vec3 Extent = Bounds.Max - Bounds.Min;
+    uint32_t AgreeCount = 0;
+    uint32_t InsideCount = 0;
+    for(uint32_t Idx = 0; Idx < Check.Points; ++Idx)
+    {
+        vec3 Point = vec3(Bounds.Min.x + Extent.x * Unit(Random),
+                          Bounds.Min.y + Extent.y * Unit(Random),
+                          Bounds.Min.z + Extent.z * Unit(Random));
+
+        bool IsInside = BSPIsPointInside(Source, Point);
+        for(const bench_solid& Solid : Removed)
+        {
+            if(!IsInside) break;
+            if((Point.x < Solid.Bounds.Min.x) || (Point.y < Solid.Bounds.Min.y) || (Point.z < Solid.Bounds.Min.z) ||
+               (Point.x > Solid.Bounds.Max.x) || (Point.y > Solid.Bounds.Max.y) || (Point.z > Solid.Bounds.Max.z))
+                continue;
+            IsInside = !BSPIsPointInside(Solid.Tree, Point);
+        }
+
+        InsideCount += IsInside;
+        AgreeCount += (IsInside == BSPIsPointInside(Stock.Tree, Point));
+    }
+
+    Check.Agreement = (double)AgreeCount / Check.Points;
+    Check.SampledVolume = (double)Extent.x * Extent.y * Extent.z * InsideCount / Check.Points;
+    return Check;
+}
+
+// NOTE: a path across the top of the input that goes along x and back and forth in z.
+// A step is much shorter than the radius of the tools, so every cut overlaps the ones
+// before and the stock gets deeper than BSP_MAX_DEPTH
+static std::vector<vec3>
+GetStockToolPath(aabb Bounds)
+{
+    vec3 Extent = Bounds.Max - Bounds.Min;
+    std::vector<vec3> Path;
+    for(uint32_t Step = 0; Step < STOCK_STEP_COUNT; ++Step)
+    {
+        float T = (float)Step / (STOCK_STEP_COUNT - 1);
+        Path.push_back(vec3(Bounds.Min.x + Extent.x * T,
+                            Bounds.Max.y,
+                            (Bounds.Min.z + Bounds.Max.z) * 0.5f + Extent.z * 0.25f * sinf(T * 6.0f * 3.14159265f)));
+    }
+    return Path;
+}
+
+// NOTE: cuts the path the way the worker does: a step is cut with the solid the tool
+// sweeps, unless that tree hit the depth limit, then with the tool at the end of the step.
+// Removed gets what the step took away, the swept solid as the tool at every substep
+static uint64_t
+RunStockSweep(bsp_stock& Stock, mesh& Tool, const convex_shape& Shape, const std::vector<vec3>& Path,
+              const bsp_build_params& ToolParams, std::vector<bench_solid>* Removed, uint32_t* Fallbacks)
+{
+    mesh Swept;
+    for(uint32_t Step = 0; Step < Path.size(); ++Step)
+    {
+        vec3 Start = Path[Step ? Step - 1 : 0];
+        vec3 End = Path[Step];
+        vec3 Translation = End - Start;
+
+        Tool.SetNewTransform(vec3(1), End, vec3(0));
+        polygon_soup ToolPolygons = Tool.GeneratePolygons(Tool.VertexIndices);
+        bsp_tree Cut;
+        bool IsSwept = false;
+        if(Step > 0)
+        {
+            SweepConvexShape(Shape, Translate(Start), Translation, vec3(0.8, 0.25, 0.35), Swept);
+
+            csg_stats SweptStats;
+            Cut = BuildBSPTree(Swept.GeneratePolygons(Swept.VertexIndices, Identity()), ToolParams, &SweptStats);
+            IsSwept = SweptStats.DepthCapHits == 0;
+        }
+        if(!IsSwept)
+        {
+            Cut = BuildBSPTree(ToolPolygons, ToolParams);
+            if(Fallbacks && (Step > 0)) (*Fallbacks)++;
+        }
+        BSPStockSubtract(Stock, Cut, ToolParams);
+
+        if(!Removed) continue;
+        if(!IsSwept)
+        {
+            Removed->push_back(GetSolid(ToolPolygons, ToolParams));
+            continue;
+        }
+        for(uint32_t Substep = 0; Substep <= STOCK_SUBSTEP_COUNT; ++Substep)
+        {
+            float T = (float)Substep / STOCK_SUBSTEP_COUNT;
+            vec3 Pose = Start + Translation * T;
+            Removed->push_back(GetSolid(Tool.GeneratePolygons(Tool.VertexIndices, Translate(Pose)), ToolParams));
+        }
+    }
+    return Stock.UsedTriangleCount - Stock.GeneratedGarbageCount;
+}
+
+static void
+RunInput(const bench_config& Config, const bsp_build_params& Params, const bench_input& Input,
+         std::vector<bench_result>& Results)
+{
+    const polygon_soup& Polygons = Input.Polygons;
+    uint64_t PolygonCount = Polygons.Size();
+    if(PolygonCount == 0) return;
+
+    aabb Bounds = GetPolygonsAABB(Polygons, 0, Polygons.Size());
+    vec3 Center = (Bounds.Min + Bounds.Max) * 0.5f;
+    vec3 Extent = Bounds.Max - Bounds.Min;
+
+    // NOTE: LoadMeshStream is the getline loader LoadMesh replaced, items_per_second of
+    // the two is the MB/s of both paths over the same file. LoadMesh parses in chunks on
+    // the pool of --threads, with 0 threads it is the serial parser
+    if(Input.FileSize && IsSelected(Config, "LoadMesh"))
+    {
+        bench_result Result = RunBenchmark(Config, "LoadMesh", Input, Input.FileSize, [&]()
+        {
+            mesh Loaded;
+            Loaded.LoadMesh(Input.Name, Params.Pool);
+            return (uint64_t)Loaded.VertexIndices.size();
+        });
+        Result.ItemName = "bytes";
+        Results.push_back(Result);
+    }
+    if(Input.FileSize && IsSelected(Config, "LoadMeshStream"))
+    {
+        bench_result Result = RunBenchmark(Config, "LoadMeshStream", Input, Input.FileSize, [&]()
+        {
+            mesh Loaded;
+            Loaded.LoadMeshStream(Input.Name);
+            return (uint64_t)Loaded.VertexIndices.size();
+        });
+        Result.ItemName = "bytes";
+        Results.push_back(Result);
+    }
+
+    if(IsSelected(Config, "PickSplitingPlane"))
+    {
+        Results.push_back(RunBenchmark(Config, "PickSplitingPlane", Input, PolygonCount, [&]()
+        {
+            vec4 Plane = PickSplitingPlane(Polygons, Params);
+            uint32_t Bits;
+            memcpy(&Bits, &Plane.w, sizeof(Bits));
+            return (uint64_t)Bits;
+        }));
+    }
+
+    // NOTE: an oblique plane through the center, so most inputs have polygons on both sides.
+    // Only the polygons that straddle it are split, as BuildBSPNode does
+    if(IsSelected(Config, "SplitPolygon"))
+    {
+        vec3 Normal = vec3(1, 2, 3);
+        Normal.Normalize();
+        vec4 Plane = vec4(Normal, Normal.Dot(Center));
+
+        std::vector<uint8_t> Classes(Polygons.Size());
+        ClassifyPolygonsToPlane(Polygons, 0, Polygons.Size(), Plane, Classes.data());
+        std::vector<uint32_t> Straddling;
+        for(uint32_t Idx = 0; Idx < Polygons.Size(); ++Idx)
+            if(Classes[Idx] == POLYGON_STRADDLING_PLANE) Straddling.push_back(Idx);
+
+        if(!Straddling.empty())
+        {
+            polygon_soup Front, Back;
+            Results.push_back(RunBenchmark(Config, "SplitPolygon", Input, Straddling.size(), [&]()
+            {
+                Front.Clear();
+                Back.Clear();
+                for(uint32_t Idx : Straddling)
+                    SplitPolygon(Polygons, Idx, Plane, Front, Back);
+                return (uint64_t)Front.Size() + Back.Size();
+            }));
+        }
+    }
+
+    if(IsSelected(Config, "BuildBSPTree"))
+    {
+        bench_result Result = RunBenchmark(Config, "BuildBSPTree", Input, PolygonCount, [&]()
+        {
+            bsp_tree Built = BuildBSPTree(Polygons, Params);
+            return (uint64_t)Built.Nodes.size();
+        });
+        bsp_tree Built = BuildBSPTree(Polygons, Params, &Result.Stats);
+        Result.HasStats = true;
+        Result.Quality = BSPGetTreeQuality(Built);
+        Result.HasQuality = true;
+        Results.push_back(Result);
+    }
+
+    // NOTE: the same polygons moved by a quarter of the extent, so about half of them
+    // reach the solid. All contacts are collected, so the walk does not stop early
+    if(IsSelected(Config, "BSPCollision"))
+    {
+        bsp_tree Tree = BuildBSPTree(Polygons, Params);
+        mesh Moved = Input.Mesh;
+        polygon_soup Query = Moved.GeneratePolygons(Moved.VertexIndices, Translate(Extent * 0.25f));
+        std::vector<uint32_t> Contacts;
+        Results.push_back(RunBenchmark(Config, "BSPCollision", Input, Query.Size(), [&]()
+        {
+            Contacts.clear();
+            BSPCollision(Tree, Query, &Contacts);
+            return (uint64_t)Contacts.size();
+        }));
+    }
+
+    // NOTE: a 32 sector cylinder through the center, as wide as a quarter of the input
+    if(IsSelected(Config, "MeshSubtract"))
+    {
+        mesh Tool;
+        float Radius = std::max(1e-3f, std::min(Extent.x, Extent.z) * 0.25f);
+        Tool.GenerateCylinder(32, Extent.y * 2.0f + 1.0f, Radius);
+        Tool.SetNewTransform(vec3(1), Center, vec3(0));
+
+        mesh Stock = Input.Mesh;
+        bench_result Result = RunBenchmark(Config, "MeshSubtract", Input, PolygonCount + Tool.VertexIndices.size() / 3, [&]()
+        {
+            mesh Subtracted = MeshSubtract(Stock, Tool, Params);
+            return (uint64_t)Subtracted.Vertices.size();
+        });
+        MeshSubtract(Stock, Tool, Params, &Result.Stats);
+        Result.HasStats = true;
+        Results.push_back(Result);
+    }
+
+    // NOTE: the tools reach from the top down a quarter of the input and are
+    // a twelfth as wide. StockSubtract cuts the 12 sector tool at every pose of the path,
+    // an iteration copies the uncut stock and does all cuts. Result is the number of
+    // triangles of the stock. Cylinder inputs are left out, one with more sides than
+    // BSP_MAX_DEPTH has no tree of the whole solid to check against
+    bool IsStockSubtract = IsSelected(Config, "StockSubtract");
+    bool IsStockSweep = IsSelected(Config, "StockSweep") || IsSelected(Config, "StockSweepCapped");
+    if((IsStockSubtract || IsStockSweep) && (Input.Kind != "cylinder"))
+    {
+        mesh Source = Input.Mesh;
+        bsp_stock Uncut;
+        UpdateBSPStock(Uncut, Source, Params);
+        bsp_tree SourceTree = BuildBSPTree(Polygons, Params);
+        std::vector<vec3> Path = GetStockToolPath(Bounds);
+        float Radius = std::max(1e-3f, std::min(Extent.x, Extent.z) / 24.0f);
+        const int ToolSectorCount = 12;
+
+        if(IsStockSubtract)
+        {
+            mesh Tool;
+            Tool.GenerateCylinder(ToolSectorCount, Extent.y * 0.5f, Radius);
+            std::vector<bench_solid> Tools;
+            for(vec3 Pose : Path)
+                Tools.push_back(GetSolid(Tool.GeneratePolygons(Tool.VertexIndices, Translate(Pose)), Params));
+
+            bsp_stock Stock;
+            bench_result Result = RunBenchmark(Config, "StockSubtract", Input, Tools.size(), [&]()
+            {
+                Stock = Uncut;
+                for(const bench_solid& Solid : Tools)
+                    BSPStockSubtract(Stock, Solid.Tree, Params);
+                return (uint64_t)(Stock.UsedTriangleCount - Stock.GeneratedGarbageCount);
+            });
+            Result.ItemName = "cuts";
+            Result.Check = CheckStock(Stock, SourceTree, Tools, Bounds);
+            Result.HasCheck = true;
+            Results.push_back(Result);
+        }
+
+        // NOTE: a step of StockSweep is the sweep, the tree of the swept solid and the cut.
+        // The 12 sector tool is cut with swept solids. StockSweepCapped gives the tool trees
+        // a depth limit that fits the tool and not the swept solid, every step but the first
+        // is cut at its end pose
+        const char* SweepNames[2] = {"StockSweep", "StockSweepCapped"};
+        for(uint32_t SweepIdx = 0; IsStockSweep && (SweepIdx < 2); ++SweepIdx)
+        {
+            if(!IsSelected(Config, SweepNames[SweepIdx])) continue;
+
+            mesh Tool;
+            Tool.GenerateCylinder(ToolSectorCount, Extent.y * 0.5f, Radius);
+            Tool.SetNewTransform(vec3(1), vec3(0), vec3(0));
+            convex_shape Shape;
+            UpdateConvexShape(Shape, Tool);
+
+            bsp_build_params ToolParams = Params;
+            // NOTE: the tree of the tool is a chain with one node per side and cap
+            ToolParams.MaxDepth = (SweepIdx == 0) ? STOCK_TOOL_MAX_DEPTH : ToolSectorCount + 2;
+
+            bsp_stock Stock;
+            bench_result Result = RunBenchmark(Config, SweepNames[SweepIdx], Input, Path.size(), [&]()
+            {
+                Stock = Uncut;
+                return RunStockSweep(Stock, Tool, Shape, Path, ToolParams, nullptr, nullptr);
+            });
+            Result.ItemName = "steps";
+
+            std::vector<bench_solid> Removed;
+            uint32_t Fallbacks = 0;
+            Stock = Uncut;
+            RunStockSweep(Stock, Tool, Shape, Path, ToolParams, &Removed, &Fallbacks);
+            Result.Check = CheckStock(Stock, SourceTree, Removed, Bounds);
+            Result.Check.Fallbacks = Fallbacks;
+            Result.HasCheck = true;
+            Results.push_back(Result);
+        }
+    }
+}
+
+static void
+WriteJson(FILE* File, const bench_config& Config, const std::vector<bench_result>& Results)
+{
+    fprintf(File, "{\n");
+    fprintf(File, "  \"schema\": 4,\n");
+    fprintf(File, "  \"config\": {\"strategy\": \"%s\", \"threads\": %u, \"min_iterations\": %u, \"min_time_ms\": %.0f, \"classify_isa\": \"%s\"},\n",
+            GetStrategyName(Config.Strategy), Config.ThreadCount, Config.MinIterations, Config.MinTimeMs,
+            GetClassifyIsaName(GetClassifyIsa()));
+    fprintf(File, "  \"benchmarks\": [\n");
+    for(size_t Idx = 0; Idx < Results.size(); ++Idx)
+    {
+        const bench_result& Result = Results[Idx];
+        double ItemsPerSecond = Result.MedianNs ? Result.Items * 1e9 / Result.MedianNs : 0;
+
+        // NOTE: paths are the only free text, they only need the separators escaped
+        std::string Name;
+        for(char C : Result.Input->Name)
+        {
+            if(C == '\\' || C == '"') Name += '\\';
+            Name += C;
+        }
+
+        fprintf(File, "    {\"benchmark\": \"%s\", \"input\": \"%s\", \"name\": \"%s\", \"param\": %d, "
+                      "\"polygons\": %u, \"iterations\": %u, "
+                      "\"min_ns\": %llu, \"median_ns\": %llu, \"mean_ns\": %llu, \"max_ns\": %llu, "
+                      "\"items\": %llu, \"item\": \"%s\", \"items_per_second\": %.1f, \"result\": %llu",
+                Result.Benchmark, Result.Input->Kind.c_str(), Name.c_str(), Result.Input->Param,
+                Result.Input->Polygons.Size(), Result.Iterations,
+                (unsigned long long)Result.MinNs, (unsigned long long)Result.MedianNs,
+                (unsigned long long)Result.MeanNs, (unsigned long long)Result.MaxNs,
+                (unsigned long long)Result.Items, Result.ItemName, ItemsPerSecond,
+                (unsigned long long)Result.Result);
+        if(Result.HasStats)
+        {
+            const csg_stats& Stats = Result.Stats;
+            fprintf(File, ", \"stats\": {\"polygons_in\": %u, \"polygons_out\": %u, \"split_calls\": %u, "
+                          "\"split_fragments\": %u, \"nodes\": %u, \"max_depth\": %u, \"depth_cap_hits\": %u, "
+                          "\"vertex_lookups\": %llu, \"vertex_hit_ratio\": %.4f}",
+                    Stats.PolygonsIn, Stats.PolygonsOut, Stats.SplitCalls, Stats.SplitFragments,
+                    Stats.NodeCount, Stats.MaxDepth, Stats.DepthCapHits,
+                    (unsigned long long)Stats.VertexLookups, Stats.GetVertexHitRatio());
+        }
+        if(Result.HasQuality)
+        {
+            const bsp_tree_quality& Quality = Result.Quality;
+            fprintf(File, ", \"quality\": {\"nodes\": %u, \"leaves\": %u, \"max_depth\": %u, "
+                          "\"polygons\": %u, \"average_depth\": %.3f}",
+                    Quality.NodeCount, Quality.LeafCount, Quality.MaxDepth,
+                    Quality.PolygonCount, Quality.AverageDepth);
+        }
+        if(Result.HasCheck)
+        {
+            const bench_check& Check = Result.Check;
+            fprintf(File, ", \"check\": {\"points\": %u, \"agreement\": %.6f, \"mesh_volume\": %.6f, "
+                          "\"sampled_volume\": %.6f, \"stock_depth\": %u, \"fallbacks\": %u}",
+                    Check.Points, Check.Agreement, Check.MeshVolume, Check.SampledVolume,
+                    Check.StockDepth, Check.Fallbacks);
+        }
+        fprintf(File, "}%s\n", (Idx + 1 < Results.size()) ? "," : "");
+    }
+    fprintf(File, "  ]\n");
+    fprintf(File, "}\n");
+}
+
+int main(int argc, char** argv)
+{
+    bench_config Config;
+    if(!ParseArgs(argc, argv, Config)) return 1;
+
+    task_pool* Pool = Config.ThreadCount ? new task_pool(Config.ThreadCount) : nullptr;
+    bsp_build_params Params = {};
+    Params.Strategy = Config.Strategy;
+    Params.Pool = Pool;
+
+    std::vector<bench_input> Inputs;
+    for(int SectorCount : Config.SectorCounts)
+    {
+        bench_input& Input = Inputs.emplace_back();
+        Input.Kind = "cylinder";
+        Input.Name = "cylinder";
+        Input.Param = SectorCount;
+        Input.Mesh.GenerateCylinder(SectorCount, 1.0f, 0.5f);
+        FinishInput(Input);
+    }
+
+    // NOTE: subdivided cubes are also written out as OBJ files, so LoadMesh has
+    // inputs of a known size without any assets
+    for(int Divisions : Config.Divisions)
+    {
+        bench_input& Input = Inputs.emplace_back();
+        Input.Kind = "cube";
+        Input.Name = "csgbench_cube_" + std::to_string(Divisions) + ".obj";
+        Input.Param = Divisions;
+        Input.Mesh.GenerateSubdividedCube(Divisions, 1.0f);
+        Input.FileSize = WriteObj(Input.Mesh, Input.Name);
+        FinishInput(Input);
+    }
+
+    for(const std::string& Path : Config.ObjPaths)
+    {
+        bench_input& Input = Inputs.emplace_back();
+        Input.Kind = "obj";
+        Input.Name = Path;
+        Input.FileSize = GetFileSize(Path);
+        Input.Mesh.LoadMesh(Path, Pool);
+        if(Input.Mesh.VertexIndices.empty())
+        {
+            fprintf(stderr, "could not load %s\n", Path.c_str());
+            Inputs.pop_back();
+            continue;
+        }
+        FinishInput(Input);
+    }
+
+    std::vector<bench_result> Results;
+    for(const bench_input& Input : Inputs)
+        RunInput(Config, Params, Input, Results);
+
+    for(const bench_input& Input : Inputs)
+        if(Input.Kind == "cube") remove(Input.Name.c_str());
+
+    FILE* File = Config.OutPath.empty() ? stdout : fopen(Config.OutPath.c_str(), "wb");
+    if(!File)
+    {
+        fprintf(stderr, "could not open %s\n", Config.OutPath.c_str());
+        return 1;
+    }
+    WriteJson(File, Config, Results);
+    if(File != stdout) fclose(File);
+
+    delete Pool;
+    return 0;
+}
@@ -0,0 +1,433 @@
+#include "bvh.h"
+#include "classify.h"
+
+#include <algorithm>
+#include <cstring>
+
+static void
+BVHGetTriangle(const bvh& BVH, uint32_t Idx, vec3* Result)
+{
+    Result[0] = BVH.Positions[BVH.Indices[Idx * 3 + 0]];
+    Result[1] = BVH.Positions[BVH.Indices[Idx * 3 + 1]];
+    Result[2] = BVH.Positions[BVH.Indices[Idx * 3 + 2]];
+}
+
+static bool
+BVHIsFreeSlot(const bvh& BVH, uint32_t Idx)
+{
+    return (BVH.Indices[Idx * 3 + 0] == BVH.Indices[Idx * 3 + 1]) &&
+           (BVH.Indices[Idx * 3 + 0] == BVH.Indices[Idx * 3 + 2]);
+}
+
+static void
+BVHGetTriangleBounds(const vec3* Triangle, float* Min, float* Max)
+{
+    Min[0] = std::min({Triangle[0].x, Triangle[1].x, Triangle[2].x});
+    Min[1] = std::min({Triangle[0].y, Triangle[1].y, Triangle[2].y});
+    Min[2] = std::min({Triangle[0].z, Triangle[1].z, Triangle[2].z});
+    Max[0] = std::max({Triangle[0].x, Triangle[1].x, Triangle[2].x});
+    Max[1] = std::max({Triangle[0].y, Triangle[1].y, Triangle[2].y});
+    Max[2] = std::max({Triangle[0].z, Triangle[1].z, Triangle[2].z});
+}
+
+static bool
+BVHBoundsOverlap(const float* MinA, const float* MaxA, const float* MinB, const float* MaxB)
+{
+    return (MinA[0] <= MaxB[0]) && (MaxA[0] >= MinB[0]) &&
+           (MinA[1] <= MaxB[1]) && (MaxA[1] >= MinB[1]) &&
+           (MinA[2] <= MaxB[2]) && (MaxA[2] >= MinB[2]);
+}
+
+static float
+BVHGetHalfArea(const bvh_node& Node)
+{
+    float x = Node.Max[0] - Node.Min[0];
+    float y = Node.Max[1] - Node.Min[1];
+    float z = Node.Max[2] - Node.Min[2];
+    return x * y + y * z + z * x;
+}
+
+// NOTE: children are always after their parent, so going backwards
+// every node sees the final bounds of its children
+static void
+BVHRefitBounds(bvh& BVH)
+{
+    for(uint32_t NodeIdx = BVH.Nodes.size();
+        NodeIdx-- > 0;
+        )
+    {
+        bvh_node& Node = BVH.Nodes[NodeIdx];
+        if(Node.TriangleCount)
+        {
+            for(uint32_t Axis = 0; Axis < 3; ++Axis)
+            {
+                Node.Min[Axis] =  std::numeric_limits<float>::max();
+                Node.Max[Axis] =  std::numeric_limits<float>::lowest();
+            }
+
+            for(uint32_t Idx = Node.First;
+                Idx < Node.First + Node.TriangleCount;
+                ++Idx)
+            {
+                if(BVHIsFreeSlot(BVH, Idx)) continue;
+
+                vec3 Triangle[3];
+                float Min[3], Max[3];
+                BVHGetTriangle(BVH, Idx, Triangle);
+                BVHGetTriangleBounds(Triangle, Min, Max);
+                for(uint32_t Axis = 0; Axis < 3; ++Axis)
+                {
+                    Node.Min[Axis] = std::min(Node.Min[Axis], Min[Axis]);
+                    Node.Max[Axis] = std::max(Node.Max[Axis], Max[Axis]);
+                }
+            }
+        }
+        else
+        {
+            const bvh_node& Left  = BVH.Nodes[NodeIdx + 1];
+            const bvh_node& Right = BVH.Nodes[Node.First];
+            for(uint32_t Axis = 0; Axis < 3; ++Axis)
+            {
+                Node.Min[Axis] = std::min(Left.Min[Axis], Right.Min[Axis]);
+                Node.Max[Axis] = std::max(Left.Max[Axis], Right.Max[Axis]);
+            }
+        }
+    }
+}
+
+static void
+BVHTransformPositions(bvh& BVH, const mesh& Mesh, mat4 Transform)
+{
+    BVH.Positions.resize(Mesh.Vertices.size());
+    for(uint32_t Idx = 0;
+        Idx < Mesh.Vertices.size();
+        ++Idx)
+    {
+        const v4<float>& Pos = Mesh.Vertices[Idx].Pos;
+        vec4 Position = Transform * vec4(Pos.x, Pos.y, Pos.z, 1.0f);
+        BVH.Positions[Idx] = Position.xyz;
+    }
+}
+
+// NOTE: splits at the median centroid along the longest axis of the centroid bounds
+static uint32_t
+BuildBVHNode(bvh& BVH, const std::vector<vec3>& Centroids, uint32_t First, uint32_t Count)
+{
+    uint32_t NodeIdx = BVH.Nodes.size();
+    BVH.Nodes.push_back({});
+
+    vec3 Min = vec3(std::numeric_limits<float>::max());
+    vec3 Max = vec3(std::numeric_limits<float>::lowest());
+    for(uint32_t Idx = First;
+        Idx < First + Count;
+        ++Idx)
+    {
+        const vec3& Centroid = Centroids[BVH.Triangles[Idx]];
+        Min = vec3(std::min(Min.x, Centroid.x), std::min(Min.y, Centroid.y), std::min(Min.z, Centroid.z));
+        Max = vec3(std::max(Max.x, Centroid.x), std::max(Max.y, Centroid.y), std::max(Max.z, Centroid.z));
+    }
+
+    vec3 Extent = Max - Min;
+    uint32_t Axis = 0;
+    if(Extent.y > Extent.E[Axis]) Axis = 1;
+    if(Extent.z > Extent.E[Axis]) Axis = 2;
+
+    // NOTE: triangles with the same centroid can't be split apart
+    if((Count <= BVH_MAX_LEAF_TRIANGLES) || (Extent.E[Axis] <= 0))
+    {
+        BVH.Nodes[NodeIdx].First = First;
+        BVH.Nodes[NodeIdx].TriangleCount = Count;
+        return NodeIdx;
+    }
+
+    uint32_t Mid = First + Count / 2;
+    std::nth_element(BVH.Triangles.begin() + First, BVH.Triangles.begin() + Mid, BVH.Triangles.begin() + First + Count,
+                     [&](uint32_t A, uint32_t B) { return Centroids[A].E[Axis] < Centroids[B].E[Axis]; });
+
+    BuildBVHNode(BVH, Centroids, First, Mid - First);
+    uint32_t Right = BuildBVHNode(BVH, Centroids, Mid, First + Count - Mid);
+    BVH.Nodes[NodeIdx].First = Right;
+    BVH.Nodes[NodeIdx].TriangleCount = 0;
+
+    return NodeIdx;
+}
+
+// NOTE: free slots have no place yet, they are split in the order they are in the mesh
+static uint32_t
+BuildBVHSlotNode(bvh& BVH, uint32_t First, uint32_t Count)
+{
+    uint32_t NodeIdx = BVH.Nodes.size();
+    BVH.Nodes.push_back({});
+
+    if(Count <= BVH_MAX_LEAF_TRIANGLES)
+    {
+        BVH.Nodes[NodeIdx].First = First;
+        BVH.Nodes[NodeIdx].TriangleCount = Count;
+        return NodeIdx;
+    }
+
+    uint32_t Mid = First + Count / 2;
+    BuildBVHSlotNode(BVH, First, Mid - First);
+    uint32_t Right = BuildBVHSlotNode(BVH, Mid, First + Count - Mid);
+    BVH.Nodes[NodeIdx].First = Right;
+    BVH.Nodes[NodeIdx].TriangleCount = 0;
+
+    return NodeIdx;
+}
+
+static void
+BVHCopyIndices(bvh& BVH, const mesh& Mesh)
+{
+    BVH.Indices.resize(BVH.Triangles.size() * 3);
+    for(uint32_t Idx = 0;
+        Idx < BVH.Triangles.size();
+        ++Idx)
+    {
+        uint32_t Triangle = BVH.Triangles[Idx];
+        BVH.Indices[Idx * 3 + 0] = Mesh.VertexIndices[Triangle * 3 + 0];
+        BVH.Indices[Idx * 3 + 1] = Mesh.VertexIndices[Triangle * 3 + 1];
+        BVH.Indices[Idx * 3 + 2] = Mesh.VertexIndices[Triangle * 3 + 2];
+    }
+}
+
+// NOTE: triangles go first and free slots after them. When there are both, the root
+// has the triangles on one side and the free slots on the other
+void
+BuildBVH(bvh& BVH, const mesh& Mesh, mat4 Transform)
+{
+    uint32_t TriangleCount = Mesh.VertexIndices.size() / 3;
+
+    BVH.Nodes.clear();
+    BVH.Nodes.reserve(TriangleCount ? 2 * TriangleCount : 0);
+    BVH.Triangles.resize(TriangleCount);
+    BVHTransformPositions(BVH, Mesh, Transform);
+
+    std::vector<vec3> Centroids(TriangleCount);
+    uint32_t UsedCount = 0;
+    for(uint32_t Idx = 0;
+        Idx < TriangleCount;
+        ++Idx)
+    {
+        uint32_t I0 = Mesh.VertexIndices[Idx * 3 + 0];
+        uint32_t I1 = Mesh.VertexIndices[Idx * 3 + 1];
+        uint32_t I2 = Mesh.VertexIndices[Idx * 3 + 2];
+        if((I0 == I1) && (I0 == I2)) continue;
+
+        Centroids[Idx] = (BVH.Positions[I0] + BVH.Positions[I1] + BVH.Positions[I2]) * (1.0f / 3.0f);
+        BVH.Triangles[UsedCount++] = Idx;
+    }
+
+    uint32_t SlotIdx = UsedCount;
+    for(uint32_t Idx = 0;
+        Idx < TriangleCount;
+        ++Idx)
+    {
+        if((Mesh.VertexIndices[Idx * 3 + 0] == Mesh.VertexIndices[Idx * 3 + 1]) &&
+           (Mesh.VertexIndices[Idx * 3 + 0] == Mesh.VertexIndices[Idx * 3 + 2]))
+            BVH.Triangles[SlotIdx++] = Idx;
+    }
+
+    uint32_t SlotCount = TriangleCount - UsedCount;
+    if(UsedCount && SlotCount)
+    {
+        BVH.Nodes.push_back({});
+        BuildBVHNode(BVH, Centroids, 0, UsedCount);
+        BVH.Nodes[0].First = BuildBVHSlotNode(BVH, UsedCount, SlotCount);
+        BVH.Nodes[0].TriangleCount = 0;
+    }
+    else if(UsedCount)
+    {
+        BuildBVHNode(BVH, Centroids, 0, UsedCount);
+    }
+    else if(SlotCount)
+    {
+        BuildBVHSlotNode(BVH, 0, SlotCount);
+    }
+
+    BVHCopyIndices(BVH, Mesh);
+    BVHRefitBounds(BVH);
+
+    BVH.GeometryVersion = Mesh.GeometryVersion;
+    BVH.Transform = Transform;
+    BVH.IsValid = true;
+}
+
+void
+RefitBVH(bvh& BVH, const mesh& Mesh, mat4 Transform)
+{
+    BVHTransformPositions(BVH, Mesh, Transform);
+    BVHRefitBounds(BVH);
+    BVH.Transform = Transform;
+}
+
+void
+RefitBVHTriangles(bvh& BVH, const mesh& Mesh, mat4 Transform)
+{
+    if(!BVH.IsValid || (BVH.Triangles.size() != Mesh.VertexIndices.size() / 3))
+    {
+        BuildBVH(BVH, Mesh, Transform);
+        return;
+    }
+
+    BVHTransformPositions(BVH, Mesh, Transform);
+    BVHCopyIndices(BVH, Mesh);
+    BVHRefitBounds(BVH);
+    BVH.GeometryVersion = Mesh.GeometryVersion;
+    BVH.Transform = Transform;
+}
+
+bool
+UpdateBVH(bvh& BVH, const mesh& Mesh, mat4 Transform)
+{
+    bool IsSameTransform = memcmp(BVH.Transform.V, Transform.V, sizeof(Transform.V)) == 0;
+    bool IsSameGeometry = BVH.IsValid && (BVH.GeometryVersion == Mesh.GeometryVersion);
+    if(IsSameGeometry && IsSameTransform) return false;
+
+    if(IsSameGeometry) RefitBVH(BVH, Mesh, Transform);
+    else BuildBVH(BVH, Mesh, Transform);
+
+    return true;
+}
+
+// NOTE: separating axis test with the two normals, the 9 edge pairs and the edge normals
+// in both triangle planes, which are needed when the triangles are coplanar
+bool
+TrianglesIntersect(const vec3* A, const vec3* B)
+{
+    vec3 EdgesA[3], EdgesB[3];
+    for(uint32_t Idx = 0; Idx < 3; ++Idx)
+    {
+        vec3 NextA = A[(Idx + 1) % 3];
+        vec3 NextB = B[(Idx + 1) % 3];
+        EdgesA[Idx] = NextA - A[Idx];
+        EdgesB[Idx] = NextB - B[Idx];
+    }
+
+    vec3 Axes[17];
+    uint32_t AxisCount = 0;
+    vec3 NormalA = Cross(EdgesA[0], EdgesA[1]);
+    vec3 NormalB = Cross(EdgesB[0], EdgesB[1]);
+    Axes[AxisCount++] = NormalA;
+    Axes[AxisCount++] = NormalB;
+    for(uint32_t IdxA = 0; IdxA < 3; ++IdxA)
+    {
+        for(uint32_t IdxB = 0; IdxB < 3; ++IdxB)
+        {
+            Axes[AxisCount++] = Cross(EdgesA[IdxA], EdgesB[IdxB]);
+        }
+    }
+    for(uint32_t Idx = 0; Idx < 3; ++Idx)
+    {
+        Axes[AxisCount++] = Cross(NormalA, EdgesA[Idx]);
+        Axes[AxisCount++] = Cross(NormalB, EdgesB[Idx]);
+    }
+
+    for(uint32_t AxisIdx = 0;
+        AxisIdx < AxisCount;
+        ++AxisIdx)
+    {
+        vec3 Axis = Axes[AxisIdx];
+        float Length = Axis.Length();
+        if(Length == 0) continue;
+
+        float MinA = std::numeric_limits<float>::max(), MaxA = std::numeric_limits<float>::lowest();
+        float MinB = std::numeric_limits<float>::max(), MaxB = std::numeric_limits<float>::lowest();
+        for(uint32_t Idx = 0; Idx < 3; ++Idx)
+        {
+            float ProjA = Axis.Dot(A[Idx]);
+            float ProjB = Axis.Dot(B[Idx]);
+            MinA = std::min(MinA, ProjA);
+            MaxA = std::max(MaxA, ProjA);
+            MinB = std::min(MinB, ProjB);
+            MaxB = std::max(MaxB, ProjB);
+        }
+
+        // NOTE: overlapping by less than the plane thickness is touching
+        float Thickness = PLANE_THICKNESS * Length;
+        if((MaxA <= MinB + Thickness) || (MaxB <= MinA + Thickness)) return false;
+    }
+
+    return true;
+}
+
+static bool
+BVHWalk(const bvh& A, const bvh& B, bool IsExact, std::vector<bvh_pair>* Pairs)
+{
+    if(A.Nodes.empty() || B.Nodes.empty()) return false;
+
+    bool Result = false;
+    std::vector<std::pair<uint32_t, uint32_t>> Stack;
+    Stack.push_back({0, 0});
+    while(!Stack.empty())
+    {
+        auto [NodeIdxA, NodeIdxB] = Stack.back();
+        Stack.pop_back();
+
+        const bvh_node& NodeA = A.Nodes[NodeIdxA];
+        const bvh_node& NodeB = B.Nodes[NodeIdxB];
+        if(!BVHBoundsOverlap(NodeA.Min, NodeA.Max, NodeB.Min, NodeB.Max)) continue;
+
+        bool IsLeafA = NodeA.TriangleCount != 0;
+        bool IsLeafB = NodeB.TriangleCount != 0;
+        if(IsLeafA && IsLeafB)
+        {
+            for(uint32_t IdxA = NodeA.First;
+                IdxA < NodeA.First + NodeA.TriangleCount;
+                ++IdxA)
+            {
+                if(BVHIsFreeSlot(A, IdxA)) continue;
+
+                vec3 TriangleA[3];
+                float MinA[3], MaxA[3];
+                BVHGetTriangle(A, IdxA, TriangleA);
+                BVHGetTriangleBounds(TriangleA, MinA, MaxA);
+                if(!BVHBoundsOverlap(MinA, MaxA, NodeB.Min, NodeB.Max)) continue;
+
+                for(uint32_t IdxB = NodeB.First;
+                    IdxB < NodeB.First + NodeB.TriangleCount;
+                    ++IdxB)
+                {
+                    if(BVHIsFreeSlot(B, IdxB)) continue;
+
+                    vec3 TriangleB[3];
+                    float MinB[3], MaxB[3];
+                    BVHGetTriangle(B, IdxB, TriangleB);
+                    BVHGetTriangleBounds(TriangleB, MinB, MaxB);
+                    if(!BVHBoundsOverlap(MinA, MaxA, MinB, MaxB)) continue;
+                    if(IsExact && !TrianglesIntersect(TriangleA, TriangleB)) continue;
+
+                    Result = true;
+                    if(!Pairs) return true;
+                    Pairs->push_back({A.Triangles[IdxA], B.Triangles[IdxB]});
+                }
+            }
+        }
+        else if(IsLeafB || (!IsLeafA && (BVHGetHalfArea(NodeA) >= BVHGetHalfArea(NodeB))))
+        {
+            // NOTE: the larger node is opened, so both sides shrink at the same pace
+            Stack.push_back({NodeA.First, NodeIdxB});
+            Stack.push_back({NodeIdxA + 1, NodeIdxB});
+        }
+        else
+        {
+            Stack.push_back({NodeIdxA, NodeB.First});
+            Stack.push_back({NodeIdxA, NodeIdxB + 1});
+        }
+    }
+
+    return Result;
+}
+
+void
+BVHOverlap(const bvh& A, const bvh& B, std::vector<bvh_pair>& Pairs)
+{
+    Pairs.clear();
+    BVHWalk(A, B, false, &Pairs);
+}
+
+bool
+BVHIntersect(const bvh& A, const bvh& B, std::vector<bvh_pair>* Pairs)
+{
+    if(Pairs) Pairs->clear();
+    return BVHWalk(A, B, true, Pairs);
+}
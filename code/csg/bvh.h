@@ -0,0 +1,70 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include "mat_h.hpp"
+#include "mesh.h"
+
+#include <vector>
+
+const uint32_t BVH_MAX_LEAF_TRIANGLES = 4;
+
+// NOTE: 32 bytes, so two nodes fit in a cache line. Nodes are stored depth first,
+// the first child of an inner node is the next node and First is the second one.
+// A leaf has TriangleCount > 0 and owns triangles [First, First + TriangleCount)
+struct bvh_node
+{
+    float Min[3];
+    uint32_t First;
+    float Max[3];
+    uint32_t TriangleCount;
+};
+
+// NOTE: bounding volume hierarchy over the triangles of a mesh. The topology is built
+// once per geometry version, a new transform only moves Positions and refits the
+// bounds from the leaves up. Indices are the triangle corners in leaf order and
+// Triangles[Idx] is the index of leaf order triangle Idx in the mesh.
+// A triangle with the same index at all three corners is a free slot. It has no area,
+// so it is left out of the bounds and does not cross anything. Free slots are built into
+// a subtree of their own in mesh order, so a range of them that is filled later and
+// refit gets bounds about as tight as a build would give
+struct bvh
+{
+    std::vector<bvh_node> Nodes;
+    std::vector<uint32_t> Triangles;
+    std::vector<uint32_t> Indices;
+    std::vector<vec3> Positions;
+
+    uint64_t GeometryVersion = 0;
+    mat4 Transform = {};
+    bool IsValid = false;
+};
+
+// NOTE: A and B are triangle indices in the first and the second mesh
+struct bvh_pair
+{
+    uint32_t A;
+    uint32_t B;
+};
+
+void BuildBVH(bvh& BVH, const mesh& Mesh, mat4 Transform);
+void RefitBVH(bvh& BVH, const mesh& Mesh, mat4 Transform);
+
+// NOTE: for a mesh whose triangles were changed in place, like free slots that were
+// filled or triangles that were made free slots. The topology is kept and only the
+// corners and the bounds are updated. Builds if the number of triangles changed
+void RefitBVHTriangles(bvh& BVH, const mesh& Mesh, mat4 Transform);
+
+// NOTE: builds when the geometry of the mesh changed, refits when only the transform did.
+// Returns true if anything changed
+bool UpdateBVH(bvh& BVH, const mesh& Mesh, mat4 Transform);
+
+// NOTE: walks both trees at once and gives the triangle pairs which bounds overlap
+void BVHOverlap(const bvh& A, const bvh& B, std::vector<bvh_pair>& Pairs);
+
+// NOTE: true if a triangle of A crosses a triangle of B, touching does not count.
+// If Pairs is given, it gets all crossing pairs, otherwise the walk stops at the first one
+bool BVHIntersect(const bvh& A, const bvh& B, std::vector<bvh_pair>* Pairs = nullptr);
+
+bool TrianglesIntersect(const vec3* A, const vec3* B);
+
+#endif // BVH_H
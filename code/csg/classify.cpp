@@ -0,0 +1,253 @@
+#include "classify.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define CLASSIFY_TARGET_AVX2
+#else
+#define CLASSIFY_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+// NOTE: indexed by (AnyInFront | (AnyBehind << 1))
+static const uint8_t PolygonPositionTable[4] =
+{
+    POLYGON_COPLANAR_WITH_PLANE,
+    POLYGON_IN_FRONT_OF_PLANE,
+    POLYGON_BEHIND_PLANE,
+    POLYGON_STRADDLING_PLANE,
+};
+
+uint32_t
+ClassifyPointToPlane(vec3 P, vec4 Plane)
+{
+    vec3 Normal = Plane.xyz;
+    float Dist = Normal.Dot(P) - Plane.w;
+
+    if(Dist >  PLANE_THICKNESS)
+        return POINT_IN_FRONT_OF_PLANE;
+    if(Dist < -PLANE_THICKNESS)
+        return POINT_BEHIND_PLANE;
+    return POINT_ON_PLANE;
+}
+
+uint32_t
+ClassifyPolygonToPlane(const polygon &Polygon, vec4 Plane)
+{
+    uint32_t NumInFront = 0, NumBehind = 0;
+    for(uint32_t PointIdx = 0;
+        PointIdx < 3;
+        ++PointIdx)
+    {
+        vec4 PolygonPos = Polygon[PointIdx].Pos;
+        switch(ClassifyPointToPlane(PolygonPos.xyz, Plane))
+        {
+            case POINT_IN_FRONT_OF_PLANE:
+            {
+                NumInFront++;
+            } break;
+            case POINT_BEHIND_PLANE:
+            {
+                NumBehind++;
+            } break;
+        }
+    }
+
+    if(NumBehind  != 0 && NumInFront != 0) return POLYGON_STRADDLING_PLANE;
+    if(NumInFront != 0) return POLYGON_IN_FRONT_OF_PLANE;
+    if(NumBehind  != 0) return POLYGON_BEHIND_PLANE;
+    return POLYGON_COPLANAR_WITH_PLANE;
+}
+
+uint32_t
+ClassifyPolygonToPlane(const polygon_soup& Polygons, uint32_t Idx, vec4 Plane)
+{
+    uint32_t NumInFront = 0, NumBehind = 0;
+    for(uint32_t PointIdx = 0;
+        PointIdx < 3;
+        ++PointIdx)
+    {
+        switch(ClassifyPointToPlane(Polygons.GetPos(Idx, PointIdx), Plane))
+        {
+            case POINT_IN_FRONT_OF_PLANE:
+            {
+                NumInFront++;
+            } break;
+            case POINT_BEHIND_PLANE:
+            {
+                NumBehind++;
+            } break;
+        }
+    }
+
+    return PolygonPositionTable[(NumInFront != 0) | ((NumBehind != 0) << 1)];
+}
+
+static void
+ClassifyPolygonsScalar(const polygon_soup& Polygons, uint32_t First, uint32_t Count, vec4 Plane, uint8_t* Result)
+{
+    for(uint32_t Idx = 0;
+        Idx < Count;
+        ++Idx)
+    {
+        Result[Idx] = ClassifyPolygonToPlane(Polygons, First + Idx, Plane);
+    }
+}
+
+static void
+ClassifyPolygonsSSE(const polygon_soup& Polygons, uint32_t First, uint32_t Count, vec4 Plane, uint8_t* Result)
+{
+    const __m128 NormalX = _mm_set1_ps(Plane.x);
+    const __m128 NormalY = _mm_set1_ps(Plane.y);
+    const __m128 NormalZ = _mm_set1_ps(Plane.z);
+    const __m128 PlaneW  = _mm_set1_ps(Plane.w);
+    const __m128 PosThickness = _mm_set1_ps( PLANE_THICKNESS);
+    const __m128 NegThickness = _mm_set1_ps(-PLANE_THICKNESS);
+
+    uint32_t Idx = 0;
+    for(;
+        Idx + 4 <= Count;
+        Idx += 4)
+    {
+        __m128 AnyInFront = _mm_setzero_ps();
+        __m128 AnyBehind  = _mm_setzero_ps();
+        for(uint32_t VertIdx = 0;
+            VertIdx < 3;
+            ++VertIdx)
+        {
+            __m128 X = _mm_loadu_ps(Polygons.X[VertIdx].data() + First + Idx);
+            __m128 Y = _mm_loadu_ps(Polygons.Y[VertIdx].data() + First + Idx);
+            __m128 Z = _mm_loadu_ps(Polygons.Z[VertIdx].data() + First + Idx);
+
+            // NOTE: same order of operations as vec3::Dot, so that results match the scalar path
+            __m128 Dist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(NormalX, X), _mm_mul_ps(NormalY, Y)), _mm_mul_ps(NormalZ, Z));
+            Dist = _mm_sub_ps(Dist, PlaneW);
+
+            AnyInFront = _mm_or_ps(AnyInFront, _mm_cmpgt_ps(Dist, PosThickness));
+            AnyBehind  = _mm_or_ps(AnyBehind,  _mm_cmplt_ps(Dist, NegThickness));
+        }
+
+        uint32_t InFrontBits = _mm_movemask_ps(AnyInFront);
+        uint32_t BehindBits  = _mm_movemask_ps(AnyBehind);
+        for(uint32_t Lane = 0;
+            Lane < 4;
+            ++Lane)
+        {
+            Result[Idx + Lane] = PolygonPositionTable[((InFrontBits >> Lane) & 1) | (((BehindBits >> Lane) & 1) << 1)];
+        }
+    }
+
+    ClassifyPolygonsScalar(Polygons, First + Idx, Count - Idx, Plane, Result + Idx);
+}
+
+CLASSIFY_TARGET_AVX2 static void
+ClassifyPolygonsAVX2(const polygon_soup& Polygons, uint32_t First, uint32_t Count, vec4 Plane, uint8_t* Result)
+{
+    const __m256 NormalX = _mm256_set1_ps(Plane.x);
+    const __m256 NormalY = _mm256_set1_ps(Plane.y);
+    const __m256 NormalZ = _mm256_set1_ps(Plane.z);
+    const __m256 PlaneW  = _mm256_set1_ps(Plane.w);
+    const __m256 PosThickness = _mm256_set1_ps( PLANE_THICKNESS);
+    const __m256 NegThickness = _mm256_set1_ps(-PLANE_THICKNESS);
+
+    uint32_t Idx = 0;
+    for(;
+        Idx + 8 <= Count;
+        Idx += 8)
+    {
+        __m256 AnyInFront = _mm256_setzero_ps();
+        __m256 AnyBehind  = _mm256_setzero_ps();
+        for(uint32_t VertIdx = 0;
+            VertIdx < 3;
+            ++VertIdx)
+        {
+            __m256 X = _mm256_loadu_ps(Polygons.X[VertIdx].data() + First + Idx);
+            __m256 Y = _mm256_loadu_ps(Polygons.Y[VertIdx].data() + First + Idx);
+            __m256 Z = _mm256_loadu_ps(Polygons.Z[VertIdx].data() + First + Idx);
+
+            __m256 Dist = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(NormalX, X), _mm256_mul_ps(NormalY, Y)), _mm256_mul_ps(NormalZ, Z));
+            Dist = _mm256_sub_ps(Dist, PlaneW);
+
+            AnyInFront = _mm256_or_ps(AnyInFront, _mm256_cmp_ps(Dist, PosThickness, _CMP_GT_OQ));
+            AnyBehind  = _mm256_or_ps(AnyBehind,  _mm256_cmp_ps(Dist, NegThickness, _CMP_LT_OQ));
+        }
+
+        uint32_t InFrontBits = _mm256_movemask_ps(AnyInFront);
+        uint32_t BehindBits  = _mm256_movemask_ps(AnyBehind);
+        for(uint32_t Lane = 0;
+            Lane < 8;
+            ++Lane)
+        {
+            Result[Idx + Lane] = PolygonPositionTable[((InFrontBits >> Lane) & 1) | (((BehindBits >> Lane) & 1) << 1)];
+        }
+    }
+
+    ClassifyPolygonsScalar(Polygons, First + Idx, Count - Idx, Plane, Result + Idx);
+}
+
+static bool
+IsAVX2Supported()
+{
+#if defined(_MSC_VER)
+    int Info[4] = {};
+    __cpuid(Info, 0);
+    if(Info[0] < 7) return false;
+
+    // NOTE: the OS also has to save ymm registers on context switch
+    __cpuid(Info, 1);
+    bool HasOSXSave = Info[2] & (1 << 27);
+    bool HasAVX     = Info[2] & (1 << 28);
+    if(!HasOSXSave || !HasAVX) return false;
+    if((_xgetbv(0) & 6) != 6) return false;
+
+    __cpuidex(Info, 7, 0);
+    return Info[1] & (1 << 5);
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+static classify_isa CurrentIsa = IsAVX2Supported() ? classify_isa_avx2 : classify_isa_sse;
+
+classify_isa
+GetClassifyIsa()
+{
+    return CurrentIsa;
+}
+
+void
+SetClassifyIsa(classify_isa Isa)
+{
+    if((Isa == classify_isa_avx2) && !IsAVX2Supported()) Isa = classify_isa_sse;
+    CurrentIsa = Isa;
+}
+
+const char*
+GetClassifyIsaName(classify_isa Isa)
+{
+    switch(Isa)
+    {
+        case classify_isa_scalar: return "scalar";
+        case classify_isa_sse: return "sse";
+        case classify_isa_avx2: return "avx2";
+    }
+    return "unknown";
+}
+
+void
+ClassifyPolygonsToPlane(const polygon_soup& Polygons, uint32_t First, uint32_t Count, vec4 Plane, uint8_t* Result)
+{
+    switch(CurrentIsa)
+    {
+        case classify_isa_scalar:
+        {
+            ClassifyPolygonsScalar(Polygons, First, Count, Plane, Result);
+        } break;
+        case classify_isa_sse:
+        {
+            ClassifyPolygonsSSE(Polygons, First, Count, Plane, Result);
+        } break;
+        case classify_isa_avx2:
+        {
+            ClassifyPolygonsAVX2(Polygons, First, Count, Plane, Result);
+        } break;
+    }
+}
@@ -0,0 +1,46 @@
+#ifndef CLASSIFY_H
+#define CLASSIFY_H
+
+#include "mat_h.hpp"
+#include "mesh.h"
+
+enum bsp_position
+{
+    POLYGON_COPLANAR_WITH_PLANE,
+    POLYGON_IN_FRONT_OF_PLANE,
+    POLYGON_BEHIND_PLANE,
+    POLYGON_STRADDLING_PLANE,
+
+    POINT_ON_PLANE,
+    POINT_IN_FRONT_OF_PLANE,
+    POINT_BEHIND_PLANE,
+};
+
+// NOTE: points closer than this to a plane are on it. It has to be above the rounding
+// error of the plane distance at scene coordinates, or a polygon is not always
+// coplanar with its own plane and the tree build keeps picking the same plane
+const float PLANE_THICKNESS = 1e-5f;
+
+enum classify_isa
+{
+    classify_isa_scalar,
+    classify_isa_sse,
+    classify_isa_avx2,
+};
+
+uint32_t ClassifyPointToPlane(vec3 P, vec4 Plane);
+uint32_t ClassifyPolygonToPlane(const polygon &Polygon, vec4 Plane);
+uint32_t ClassifyPolygonToPlane(const polygon_soup& Polygons, uint32_t Idx, vec4 Plane);
+
+// NOTE: writes POLYGON_* position of polygons [First, First + Count) to Result[Idx - First].
+// Gives the same result as ClassifyPolygonToPlane on every polygon,
+// but does 4 (SSE) or 8 (AVX2) polygons at once
+void ClassifyPolygonsToPlane(const polygon_soup& Polygons, uint32_t First, uint32_t Count, vec4 Plane, uint8_t* Result);
+
+// NOTE: the best instruction set is picked at startup from cpuid,
+// it can be overridden to compare the paths
+classify_isa GetClassifyIsa();
+void SetClassifyIsa(classify_isa Isa);
+const char* GetClassifyIsaName(classify_isa Isa);
+
+#endif // CLASSIFY_H
@@ -0,0 +1,879 @@
+#include "convex.h"
+#include "classify.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <unordered_map>
+
+// NOTE: point of the Minkowski difference A - B and the points of A and B it came from
+struct gjk_vertex
+{
+    vec3 W;
+    uint32_t IdxA;
+    uint32_t IdxB;
+};
+
+struct epa_face
+{
+    uint32_t I[3];
+    vec3 Normal;
+    float Distance;
+};
+
+struct epa_edge
+{
+    uint32_t A;
+    uint32_t B;
+};
+
+static vec3
+ConvexTransformPoint(mat4 Transform, vec3 P)
+{
+    vec4 Result = Transform * vec4(P, 1.0f);
+    return vec3(Result.x, Result.y, Result.z);
+}
+
+// NOTE: max over P of Dot(Dir, Transform * P) is max over P of Dot(Transform^T * Dir, P),
+// so the walk stays in mesh space and only the found point is transformed
+static vec3
+ConvexTransformDirectionTransposed(mat4 Transform, vec3 Dir)
+{
+    return vec3(Transform.E11 * Dir.x + Transform.E21 * Dir.y + Transform.E31 * Dir.z,
+                Transform.E12 * Dir.x + Transform.E22 * Dir.y + Transform.E32 * Dir.z,
+                Transform.E13 * Dir.x + Transform.E23 * Dir.y + Transform.E33 * Dir.z);
+}
+
+// NOTE: hill climbs the edge graph from Hint and leaves the found point in it
+static uint32_t
+ConvexSupport(const convex_shape& Shape, mat4 Transform, vec3 Dir, uint32_t Hint)
+{
+    vec3 LocalDir = ConvexTransformDirectionTransposed(Transform, Dir);
+
+    uint32_t Best = (Hint < Shape.Points.size()) ? Hint : 0;
+    float BestDot = LocalDir.Dot(Shape.Points[Best]);
+    for(bool Improved = true; Improved;)
+    {
+        Improved = false;
+        for(uint32_t NeighborIdx = Shape.FirstNeighbor[Best];
+            NeighborIdx < Shape.FirstNeighbor[Best + 1];
+            ++NeighborIdx)
+        {
+            uint32_t Idx = Shape.Neighbors[NeighborIdx];
+            float Dot = LocalDir.Dot(Shape.Points[Idx]);
+            if(Dot > BestDot)
+            {
+                Best = Idx;
+                BestDot = Dot;
+                Improved = true;
+            }
+        }
+    }
+
+    return Best;
+}
+
+static gjk_vertex
+GJKSupport(const convex_shape& A, mat4 TransformA, const convex_shape& B, mat4 TransformB,
+           vec3 Dir, gjk_cache& Cache)
+{
+    gjk_vertex Result;
+    Result.IdxA = ConvexSupport(A, TransformA, Dir, Cache.SupportA);
+    Result.IdxB = ConvexSupport(B, TransformB, Dir * -1.0f, Cache.SupportB);
+    Result.W = ConvexTransformPoint(TransformA, A.Points[Result.IdxA]) -
+               ConvexTransformPoint(TransformB, B.Points[Result.IdxB]);
+
+    Cache.SupportA = Result.IdxA;
+    Cache.SupportB = Result.IdxB;
+    return Result;
+}
+
+// NOTE: products are summed in double. Near the end GJK has the origin almost on a long
+// thin triangle and the float differences of products below cancel to noise
+static double
+GJKDot(vec3 A, vec3 B)
+{
+    return (double)A.x * B.x + (double)A.y * B.y + (double)A.z * B.z;
+}
+
+// NOTE: closest point to the origin on the triangle S[0], S[1], S[2] (Ericson, 5.1.5).
+// S is reduced to the smallest feature that has the point
+static vec3
+GJKClosestOnTriangle(gjk_vertex* S, uint32_t& Count)
+{
+    vec3 A = S[0].W;
+    vec3 B = S[1].W;
+    vec3 C = S[2].W;
+    vec3 AB = B - A;
+    vec3 AC = C - A;
+
+    double D1 = -GJKDot(AB, A);
+    double D2 = -GJKDot(AC, A);
+    if(D1 <= 0 && D2 <= 0)
+    {
+        Count = 1;
+        return A;
+    }
+
+    double D3 = -GJKDot(AB, B);
+    double D4 = -GJKDot(AC, B);
+    if(D3 >= 0 && D4 <= D3)
+    {
+        S[0] = S[1];
+        Count = 1;
+        return B;
+    }
+
+    double VC = D1 * D4 - D3 * D2;
+    if(VC <= 0 && D1 >= 0 && D3 <= 0)
+    {
+        float t = (float)(D1 / (D1 - D3));
+        Count = 2;
+        return A + AB * t;
+    }
+
+    double D5 = -GJKDot(AB, C);
+    double D6 = -GJKDot(AC, C);
+    if(D6 >= 0 && D5 <= D6)
+    {
+        S[0] = S[2];
+        Count = 1;
+        return C;
+    }
+
+    double VB = D5 * D2 - D1 * D6;
+    if(VB <= 0 && D2 >= 0 && D6 <= 0)
+    {
+        float t = (float)(D2 / (D2 - D6));
+        S[1] = S[2];
+        Count = 2;
+        return A + AC * t;
+    }
+
+    double VA = D3 * D6 - D5 * D4;
+    if(VA <= 0 && (D4 - D3) >= 0 && (D5 - D6) >= 0)
+    {
+        float t = (float)((D4 - D3) / ((D4 - D3) + (D5 - D6)));
+        S[0] = S[2];
+        Count = 2;
+        return B + (C - B) * t;
+    }
+
+    double Denom = 1.0 / (VA + VB + VC);
+    double v = VB * Denom;
+    double w = VC * Denom;
+    Count = 3;
+    return vec3((float)(A.x + AB.x * v + AC.x * w),
+                (float)(A.y + AB.y * v + AC.y * w),
+                (float)(A.z + AB.z * v + AC.z * w));
+}
+
+static vec3
+GJKClosestOnSegment(gjk_vertex* S, uint32_t& Count)
+{
+    vec3 A = S[0].W;
+    vec3 AB = S[1].W - A;
+
+    float t = -A.Dot(AB);
+    if(t <= 0)
+    {
+        Count = 1;
+        return A;
+    }
+
+    float LengthSq = AB.LengthSq();
+    if(t >= LengthSq)
+    {
+        S[0] = S[1];
+        Count = 1;
+        return S[0].W;
+    }
+
+    Count = 2;
+    return A + AB * (t / LengthSq);
+}
+
+// NOTE: true if the origin and D are on the different sides of the plane of A, B, C.
+// The plane goes through the corner closest to the origin, the error of N is
+// scaled by the distance to that corner
+static bool
+GJKIsOriginOutside(vec3 A, vec3 B, vec3 C, vec3 D)
+{
+    if(B.LengthSq() < A.LengthSq()) std::swap(A, B);
+    if(C.LengthSq() < A.LengthSq()) std::swap(A, C);
+
+    vec3 N = Cross(B - A, C - A);
+    float SignOrigin = -N.Dot(A);
+    float SignD = N.Dot(D - A);
+    return SignOrigin * SignD <= 0;
+}
+
+// NOTE: volume small next to the cube of the longest edge. The side tests of a flat
+// tetrahedron are noise, so every face is a candidate and the origin is never inside
+static bool
+GJKIsFlat(gjk_vertex* S)
+{
+    float LongestSq = 0;
+    for(uint32_t I = 0; I < 4; ++I)
+        for(uint32_t J = I + 1; J < 4; ++J)
+            LongestSq = std::max(LongestSq, (S[I].W - S[J].W).LengthSq());
+
+    vec3 A = S[0].W;
+    float Volume = fabsf(Cross(S[1].W - A, S[2].W - A).Dot(S[3].W - A));
+    return Volume <= PLANE_THICKNESS * LongestSq * sqrtf(LongestSq);
+}
+
+static vec3
+GJKClosestOnTetrahedron(gjk_vertex* S, uint32_t& Count)
+{
+    static const uint32_t Faces[4][4] =
+    {
+        {0, 1, 2, 3},
+        {0, 2, 3, 1},
+        {0, 3, 1, 2},
+        {1, 3, 2, 0},
+    };
+
+    bool IsFlat = GJKIsFlat(S);
+
+    vec3 Result = {};
+    float BestDistanceSq = std::numeric_limits<float>::max();
+    gjk_vertex Best[4];
+    uint32_t BestCount = 4;
+    for(uint32_t FaceIdx = 0; FaceIdx < 4; ++FaceIdx)
+    {
+        const uint32_t* Face = Faces[FaceIdx];
+        if(!IsFlat && !GJKIsOriginOutside(S[Face[0]].W, S[Face[1]].W, S[Face[2]].W, S[Face[3]].W))
+            continue;
+
+        gjk_vertex Triangle[3] = {S[Face[0]], S[Face[1]], S[Face[2]]};
+        uint32_t TriangleCount = 3;
+        vec3 Closest = GJKClosestOnTriangle(Triangle, TriangleCount);
+        float DistanceSq = Closest.LengthSq();
+        if(DistanceSq < BestDistanceSq)
+        {
+            BestDistanceSq = DistanceSq;
+            Result = Closest;
+            std::copy(Triangle, Triangle + TriangleCount, Best);
+            BestCount = TriangleCount;
+        }
+    }
+
+    // NOTE: the origin is inside of the tetrahedron
+    if(BestCount == 4)
+        return vec3(0, 0, 0);
+
+    std::copy(Best, Best + BestCount, S);
+    Count = BestCount;
+    return Result;
+}
+
+static vec3
+GJKClosestOnSimplex(gjk_vertex* S, uint32_t& Count)
+{
+    switch(Count)
+    {
+        case 1: return S[0].W;
+        case 2: return GJKClosestOnSegment(S, Count);
+        case 3: return GJKClosestOnTriangle(S, Count);
+        default: return GJKClosestOnTetrahedron(S, Count);
+    }
+}
+
+static bool
+EPAMakeFace(const std::vector<gjk_vertex>& Points, uint32_t A, uint32_t B, uint32_t C, epa_face& Face)
+{
+    vec3 PA = Points[A].W;
+    vec3 PB = Points[B].W;
+    vec3 PC = Points[C].W;
+    vec3 N = Cross(PB - PA, PC - PA);
+    float Length = N.Length();
+    if(Length <= std::numeric_limits<float>::min())
+        return false;
+
+    N = N / Length;
+    Face.I[0] = A;
+    Face.I[1] = B;
+    Face.I[2] = C;
+    Face.Normal = N;
+    Face.Distance = N.Dot(PA);
+    return true;
+}
+
+// NOTE: a simplex that has the origin on its boundary gets points until it is a
+// tetrahedron. Returns false if the Minkowski difference is flat
+static bool
+EPAFillSimplex(const convex_shape& A, mat4 TransformA, const convex_shape& B, mat4 TransformB,
+               gjk_vertex* S, uint32_t& Count, gjk_cache& Cache)
+{
+    static vec3 Axes[3] = {vec3(1, 0, 0), vec3(0, 1, 0), vec3(0, 0, 1)};
+
+    float Tolerance = PLANE_THICKNESS * PLANE_THICKNESS;
+    if(Count == 1)
+    {
+        for(uint32_t AxisIdx = 0; AxisIdx < 6 && Count == 1; ++AxisIdx)
+        {
+            vec3 Dir = Axes[AxisIdx / 2] * ((AxisIdx & 1) ? -1.0f : 1.0f);
+            gjk_vertex New = GJKSupport(A, TransformA, B, TransformB, Dir, Cache);
+            if((New.W - S[0].W).LengthSq() > Tolerance)
+                S[Count++] = New;
+        }
+    }
+
+    if(Count == 2)
+    {
+        vec3 Segment = S[1].W - S[0].W;
+        for(uint32_t AxisIdx = 0; AxisIdx < 6 && Count == 2; ++AxisIdx)
+        {
+            vec3 Dir = Cross(Segment, Axes[AxisIdx / 2]) * ((AxisIdx & 1) ? -1.0f : 1.0f);
+            if(Dir.LengthSq() <= Tolerance)
+                continue;
+
+            gjk_vertex New = GJKSupport(A, TransformA, B, TransformB, Dir, Cache);
+            if(Cross(Segment, New.W - S[0].W).LengthSq() > Tolerance)
+                S[Count++] = New;
+        }
+    }
+
+    if(Count == 3)
+    {
+        vec3 N = Cross(S[1].W - S[0].W, S[2].W - S[0].W);
+        for(uint32_t Side = 0; Side < 2 && Count == 3; ++Side)
+        {
+            vec3 Dir = N * (Side ? -1.0f : 1.0f);
+            gjk_vertex New = GJKSupport(A, TransformA, B, TransformB, Dir, Cache);
+            if(fabsf(N.Dot(New.W - S[0].W)) > Tolerance)
+                S[Count++] = New;
+        }
+    }
+
+    return Count == 4;
+}
+
+static void
+EPAAddEdge(std::vector<epa_edge>& Edges, uint32_t A, uint32_t B)
+{
+    // NOTE: an edge shared by two removed faces is inside of the hole, they see it in opposite directions
+    for(size_t Idx = 0; Idx < Edges.size(); ++Idx)
+    {
+        if(Edges[Idx].A == B && Edges[Idx].B == A)
+        {
+            Edges[Idx] = Edges.back();
+            Edges.pop_back();
+            return;
+        }
+    }
+    Edges.push_back({A, B});
+}
+
+static void
+EPAPenetration(const convex_shape& A, mat4 TransformA, const convex_shape& B, mat4 TransformB,
+               const gjk_vertex* S, gjk_cache& Cache, convex_contact& Result)
+{
+    std::vector<gjk_vertex> Points(S, S + 4);
+    std::vector<epa_face> Faces;
+    std::vector<epa_edge> Edges;
+
+    // NOTE: faces are wound so that normals point away from the opposite point.
+    // New faces take the winding of the horizon edges, so it stays outward
+    static const uint32_t Tetrahedron[4][4] = {{0, 1, 2, 3}, {0, 3, 1, 2}, {0, 2, 3, 1}, {1, 3, 2, 0}};
+    for(uint32_t FaceIdx = 0; FaceIdx < 4; ++FaceIdx)
+    {
+        const uint32_t* I = Tetrahedron[FaceIdx];
+        epa_face Face;
+        if(!EPAMakeFace(Points, I[0], I[1], I[2], Face))
+            continue;
+
+        if(Face.Normal.Dot(Points[I[3]].W - Points[I[0]].W) > 0)
+            EPAMakeFace(Points, I[0], I[2], I[1], Face);
+        Faces.push_back(Face);
+    }
+
+    // NOTE: the closest face is a lower bound of the depth and the support along its normal
+    // is an upper bound, moving B by that much along the normal separates the shapes.
+    // The best upper bound is the result, so a polytope that did not converge within
+    // EPA_MAX_ITERATIONS still gives a translation that separates
+    if(Faces.empty())
+        return;
+
+    Result.Depth = std::numeric_limits<float>::max();
+    for(uint32_t Iteration = 0; Iteration < EPA_MAX_ITERATIONS && !Faces.empty(); ++Iteration)
+    {
+        epa_face Closest = *std::min_element(Faces.begin(), Faces.end(), [](const epa_face& L, const epa_face& R)
+        {
+            return L.Distance < R.Distance;
+        });
+
+        gjk_vertex New = GJKSupport(A, TransformA, B, TransformB, Closest.Normal, Cache);
+        float Support = Closest.Normal.Dot(New.W);
+        if(Support < Result.Depth)
+        {
+            Result.Depth = Support;
+            Result.Normal = Closest.Normal;
+        }
+
+        if(Support - Closest.Distance <= PLANE_THICKNESS)
+            break;
+
+        // NOTE: faces that the new point is almost on are kept. Flat sides, like the ones
+        // of a cylinder against a box, give many such points and removing a face on
+        // the sign of noise leaves a horizon that is not a loop
+        Edges.clear();
+        uint32_t NewIdx = (uint32_t)Points.size();
+        Points.push_back(New);
+        for(size_t FaceIdx = 0; FaceIdx < Faces.size();)
+        {
+            epa_face& Face = Faces[FaceIdx];
+            if(Face.Normal.Dot(New.W - Points[Face.I[0]].W) > PLANE_THICKNESS)
+            {
+                EPAAddEdge(Edges, Face.I[0], Face.I[1]);
+                EPAAddEdge(Edges, Face.I[1], Face.I[2]);
+                EPAAddEdge(Edges, Face.I[2], Face.I[0]);
+                Face = Faces.back();
+                Faces.pop_back();
+            }
+            else
+            {
+                ++FaceIdx;
+            }
+        }
+
+        for(const epa_edge& Edge : Edges)
+        {
+            epa_face Face;
+            if(EPAMakeFace(Points, Edge.A, Edge.B, NewIdx, Face))
+                Faces.push_back(Face);
+        }
+    }
+}
+
+convex_contact
+GJKCollide(const convex_shape& A, mat4 TransformA,
+           const convex_shape& B, mat4 TransformB, gjk_cache& Cache)
+{
+    convex_contact Result = {};
+    if(A.Points.empty() || B.Points.empty())
+        return Result;
+
+    gjk_vertex Simplex[4];
+    uint32_t Count = 0;
+    Simplex[Count++] = GJKSupport(A, TransformA, B, TransformB, Cache.Direction, Cache);
+    vec3 V = Simplex[0].W;
+
+    bool IsIntersecting = false;
+    bool IsStalled = false;
+    for(uint32_t Iteration = 0; Iteration < GJK_MAX_ITERATIONS; ++Iteration)
+    {
+        Result.IterationCount = Iteration + 1;
+
+        float DistanceSq = V.LengthSq();
+        if(DistanceSq <= PLANE_THICKNESS * PLANE_THICKNESS)
+        {
+            IsIntersecting = true;
+            break;
+        }
+
+        gjk_vertex New = GJKSupport(A, TransformA, B, TransformB, V * -1.0f, Cache);
+
+        // NOTE: no point of A - B is closer to the origin along V, V is the closest point
+        if(DistanceSq - V.Dot(New.W) <= PLANE_THICKNESS * sqrtf(DistanceSq))
+            break;
+
+        // NOTE: a support point that is already in the simplex, or one that does not get
+        // the simplex closer, means V is as close as float gets. If that point is past the
+        // origin, the plane of V does not separate the shapes either, so they are within
+        // the float error of touching. EPA would start from a simplex that may not have
+        // the origin inside and its depth could be anything
+        bool IsDuplicate = false;
+        for(uint32_t Idx = 0; Idx < Count; ++Idx)
+            IsDuplicate |= (Simplex[Idx].IdxA == New.IdxA) && (Simplex[Idx].IdxB == New.IdxB);
+        if(IsDuplicate)
+        {
+            IsStalled = V.Dot(New.W) <= 0;
+            break;
+        }
+
+        Simplex[Count++] = New;
+        vec3 Closest = GJKClosestOnSimplex(Simplex, Count);
+        if(Count == 4)
+        {
+            IsIntersecting = true;
+            break;
+        }
+
+        if(Closest.LengthSq() >= DistanceSq)
+        {
+            IsStalled = V.Dot(New.W) <= 0;
+            break;
+        }
+        V = Closest;
+    }
+
+    if(IsStalled)
+    {
+        Result.Normal = V * (-1.0f / V.Length());
+        Cache.Direction = V * -1.0f;
+        return Result;
+    }
+
+    if(!IsIntersecting)
+    {
+        Result.Distance = V.Length();
+        Result.Normal = V * (-1.0f / Result.Distance);
+        Cache.Direction = V * -1.0f;
+        return Result;
+    }
+
+    if(!EPAFillSimplex(A, TransformA, B, TransformB, Simplex, Count, Cache))
+        return Result;
+
+    EPAPenetration(A, TransformA, B, TransformB, Simplex, Cache, Result);
+    Result.IsColliding = Result.Depth > PLANE_THICKNESS;
+    Cache.Direction = Result.Normal;
+    return Result;
+}
+
+// NOTE: PLANE_THICKNESS scaled by the size of the mesh
+static float
+ConvexGetTolerance(const mesh& Mesh)
+{
+    aabb Bounds = {vec3(std::numeric_limits<float>::max()), vec3(std::numeric_limits<float>::lowest())};
+    for(const vertex& Vertex : Mesh.Vertices)
+    {
+        Bounds.Min = vec3(std::min(Bounds.Min.x, Vertex.Pos.x), std::min(Bounds.Min.y, Vertex.Pos.y), std::min(Bounds.Min.z, Vertex.Pos.z));
+        Bounds.Max = vec3(std::max(Bounds.Max.x, Vertex.Pos.x), std::max(Bounds.Max.y, Vertex.Pos.y), std::max(Bounds.Max.z, Vertex.Pos.z));
+    }
+    return PLANE_THICKNESS * std::max(1.0f, (Bounds.Max - Bounds.Min).Length());
+}
+
+static uint64_t
+ConvexGetCellKey(int64_t x, int64_t y, int64_t z)
+{
+    return ((uint64_t)(x & 0x1FFFFF) << 42) | ((uint64_t)(y & 0x1FFFFF) << 21) | (uint64_t)(z & 0x1FFFFF);
+}
+
+// NOTE: Vertices are split by normals and seams, Points are the positions welded
+// within the tolerance and VertexToPoint maps every vertex to its point
+static void
+ConvexWeldPoints(const mesh& Mesh, float Tolerance, std::vector<vec3>& Points, std::vector<uint32_t>& VertexToPoint)
+{
+    float InvCellSize = 1.0f / Tolerance;
+    std::unordered_multimap<uint64_t, uint32_t> Cells;
+    VertexToPoint.resize(Mesh.Vertices.size());
+    for(size_t Idx = 0; Idx < Mesh.Vertices.size(); ++Idx)
+    {
+        vec3 Pos = vec3(Mesh.Vertices[Idx].Pos.x, Mesh.Vertices[Idx].Pos.y, Mesh.Vertices[Idx].Pos.z);
+        int64_t Cell[3] = {(int64_t)floorf(Pos.x * InvCellSize), (int64_t)floorf(Pos.y * InvCellSize), (int64_t)floorf(Pos.z * InvCellSize)};
+
+        uint32_t PointIdx = (uint32_t)Points.size();
+        for(int64_t x = Cell[0] - 1; x <= Cell[0] + 1 && PointIdx == Points.size(); ++x)
+        for(int64_t y = Cell[1] - 1; y <= Cell[1] + 1 && PointIdx == Points.size(); ++y)
+        for(int64_t z = Cell[2] - 1; z <= Cell[2] + 1 && PointIdx == Points.size(); ++z)
+        {
+            auto Range = Cells.equal_range(ConvexGetCellKey(x, y, z));
+            for(auto It = Range.first; It != Range.second; ++It)
+            {
+                if((Points[It->second] - Pos).LengthSq() <= Tolerance * Tolerance)
+                {
+                    PointIdx = It->second;
+                    break;
+                }
+            }
+        }
+
+        if(PointIdx == Points.size())
+        {
+            Points.push_back(Pos);
+            Cells.emplace(ConvexGetCellKey(Cell[0], Cell[1], Cell[2]), PointIdx);
+        }
+        VertexToPoint[Idx] = PointIdx;
+    }
+}
+
+// NOTE: the center of the points of a convex mesh is behind every triangle plane.
+// Testing it first rejects most meshes that are not convex in one pass over the
+// triangles, only meshes that pass it get the test of every point against every plane
+static bool
+IsConvexPoints(const mesh& Mesh, const std::vector<vec3>& Points, float Tolerance)
+{
+    vec3 Center = vec3(0);
+    for(const vec3& Point : Points)
+        Center = Center + Point;
+    Center = Center / (float)Points.size();
+
+    std::vector<vec4> Planes;
+    Planes.reserve(Mesh.VertexIndices.size() / 3);
+    for(size_t Idx = 0; Idx + 2 < Mesh.VertexIndices.size(); Idx += 3)
+    {
+        vec4 P0 = Mesh.Vertices[Mesh.VertexIndices[Idx + 0]].Pos;
+        vec4 P1 = Mesh.Vertices[Mesh.VertexIndices[Idx + 1]].Pos;
+        vec4 P2 = Mesh.Vertices[Mesh.VertexIndices[Idx + 2]].Pos;
+        vec3 A = vec3(P0.x, P0.y, P0.z);
+        vec3 N = Cross(vec3(P1.x, P1.y, P1.z) - A, vec3(P2.x, P2.y, P2.z) - A);
+        float Length = N.Length();
+        if(Length <= std::numeric_limits<float>::min())
+            continue;
+
+        N = N / Length;
+        float D = N.Dot(A);
+        if(N.Dot(Center) - D > Tolerance)
+            return false;
+        Planes.push_back(vec4(N, D));
+    }
+
+    for(const vec4& Plane : Planes)
+    {
+        for(const vec3& Point : Points)
+        {
+            if(Plane.x * Point.x + Plane.y * Point.y + Plane.z * Point.z - Plane.w > Tolerance)
+                return false;
+        }
+    }
+
+    return true;
+}
+
+bool
+IsConvex(const mesh& Mesh)
+{
+    if(Mesh.VertexIndices.empty() || (Mesh.VertexIndices.size() / 3 > CONVEX_MAX_TRIANGLES))
+        return false;
+
+    float Tolerance = ConvexGetTolerance(Mesh);
+    std::vector<vec3> Points;
+    std::vector<uint32_t> VertexToPoint;
+    ConvexWeldPoints(Mesh, Tolerance, Points, VertexToPoint);
+    return IsConvexPoints(Mesh, Points, Tolerance);
+}
+
+bool
+IsPointInsideConvex(const mesh& Mesh, vec3 Point)
+{
+    if(Mesh.VertexIndices.empty())
+        return false;
+
+    float Tolerance = ConvexGetTolerance(Mesh);
+
+    for(size_t Idx = 0; Idx + 2 < Mesh.VertexIndices.size(); Idx += 3)
+    {
+        vec4 P0 = Mesh.Vertices[Mesh.VertexIndices[Idx + 0]].Pos;
+        vec4 P1 = Mesh.Vertices[Mesh.VertexIndices[Idx + 1]].Pos;
+        vec4 P2 = Mesh.Vertices[Mesh.VertexIndices[Idx + 2]].Pos;
+        vec3 A = vec3(P0.x, P0.y, P0.z);
+        vec3 N = Cross(vec3(P1.x, P1.y, P1.z) - A, vec3(P2.x, P2.y, P2.z) - A);
+        float Length = N.Length();
+        if(Length <= std::numeric_limits<float>::min())
+            continue;
+
+        N = N / Length;
+        if(N.Dot(Point) - N.Dot(A) > -Tolerance)
+            return false;
+    }
+
+    return true;
+}
+
+bool
+UpdateConvexShape(convex_shape& Shape, const mesh& Mesh)
+{
+    if(Shape.IsValid && Shape.GeometryVersion == Mesh.GeometryVersion)
+        return false;
+
+    Shape.GeometryVersion = Mesh.GeometryVersion;
+    Shape.IsValid = true;
+    Shape.IsConvex = false;
+
+    Shape.Points.clear();
+    Shape.FirstNeighbor.assign(1, 0);
+    Shape.Neighbors.clear();
+    Shape.Triangles.clear();
+    if(Mesh.VertexIndices.empty() || (Mesh.VertexIndices.size() / 3 > CONVEX_MAX_TRIANGLES))
+        return true;
+
+    // NOTE: the graph is over welded positions. A seam left open would cut the graph
+    // and the walk could stop at a point that is only the best one on its side of the cut
+    float Tolerance = ConvexGetTolerance(Mesh);
+    std::vector<uint32_t> VertexToPoint;
+    ConvexWeldPoints(Mesh, Tolerance, Shape.Points, VertexToPoint);
+
+    // NOTE: GJK only runs on convex shapes, there is no point in a graph for the others
+    Shape.IsConvex = IsConvexPoints(Mesh, Shape.Points, Tolerance);
+    if(!Shape.IsConvex)
+    {
+        Shape.Points.clear();
+        return true;
+    }
+
+    std::vector<uint64_t> Edges;
+    Edges.reserve(Mesh.VertexIndices.size() * 2);
+    Shape.Triangles.reserve(Mesh.VertexIndices.size());
+    for(size_t Idx = 0; Idx + 2 < Mesh.VertexIndices.size(); Idx += 3)
+    {
+        uint32_t P0 = VertexToPoint[Mesh.VertexIndices[Idx + 0]];
+        uint32_t P1 = VertexToPoint[Mesh.VertexIndices[Idx + 1]];
+        uint32_t P2 = VertexToPoint[Mesh.VertexIndices[Idx + 2]];
+        if((P0 != P1) && (P1 != P2) && (P2 != P0))
+        {
+            Shape.Triangles.push_back(P0);
+            Shape.Triangles.push_back(P1);
+            Shape.Triangles.push_back(P2);
+        }
+
+        for(uint32_t Corner = 0; Corner < 3; ++Corner)
+        {
+            uint32_t From = VertexToPoint[Mesh.VertexIndices[Idx + Corner]];
+            uint32_t To = VertexToPoint[Mesh.VertexIndices[Idx + (Corner + 1) % 3]];
+            if(From == To) continue;
+            Edges.push_back(((uint64_t)From << 32) | To);
+            Edges.push_back(((uint64_t)To << 32) | From);
+        }
+    }
+    std::sort(Edges.begin(), Edges.end());
+    Edges.erase(std::unique(Edges.begin(), Edges.end()), Edges.end());
+
+    Shape.FirstNeighbor.assign(Shape.Points.size() + 1, 0);
+    Shape.Neighbors.resize(Edges.size());
+    for(size_t Idx = 0; Idx < Edges.size(); ++Idx)
+    {
+        Shape.FirstNeighbor[(Edges[Idx] >> 32) + 1]++;
+        Shape.Neighbors[Idx] = (uint32_t)Edges[Idx];
+    }
+    for(size_t Idx = 1; Idx < Shape.FirstNeighbor.size(); ++Idx)
+        Shape.FirstNeighbor[Idx] += Shape.FirstNeighbor[Idx - 1];
+
+    return true;
+}
+
+convex_sweep
+GJKSweep(const convex_shape& A, mat4 TransformA,
+         const convex_shape& B, mat4 TransformB, vec3 Translation, gjk_cache& Cache)
+{
+    convex_sweep Result = {};
+    float Time = 0;
+    for(uint32_t Iteration = 0; Iteration < SWEEP_MAX_ITERATIONS; ++Iteration)
+    {
+        Result.IterationCount = Iteration + 1;
+
+        mat4 Moved = Translate(Translation * Time) * TransformB;
+        convex_contact Contact = GJKCollide(A, TransformA, B, Moved, Cache);
+        if(Contact.IsColliding)
+        {
+            Result.IsHit = true;
+            Result.Time = Time;
+            Result.Normal = Contact.Normal;
+            return Result;
+        }
+
+        // NOTE: B moving away from A, or along it, never closes the gap.
+        // That includes sliding along a face of A it touches
+        float Closing = -Contact.Normal.Dot(Translation);
+        if(Closing <= 0)
+            return Result;
+
+        // NOTE: touching does not count, as in GJKCollide. It is a hit only if B is in A
+        // a little further along the step, otherwise the advance goes on from there
+        if(Contact.Distance <= SWEEP_DISTANCE_TOLERANCE)
+        {
+            float ProbeTime = std::min(1.0f, Time + 2.0f * SWEEP_DISTANCE_TOLERANCE / Translation.Length());
+            if(ProbeTime <= Time)
+                return Result;
+
+            mat4 Probe = Translate(Translation * ProbeTime) * TransformB;
+            if(GJKCollide(A, TransformA, B, Probe, Cache).IsColliding)
+            {
+                Result.IsHit = true;
+                Result.Time = Time;
+                Result.Normal = Contact.Normal;
+                return Result;
+            }
+
+            Time = ProbeTime;
+            continue;
+        }
+
+        Time += Contact.Distance / Closing;
+        if(Time > 1)
+            return Result;
+    }
+
+    // NOTE: a grazing step that did not converge is taken as a hit, Time is still before the contact
+    Result.IsHit = true;
+    Result.Time = Time;
+    return Result;
+}
+
+static void
+SweepAddTriangle(mesh& Result, vec3 A, vec3 B, vec3 C, vec3 Color)
+{
+    vec3 Normal = Cross(B - A, C - A);
+    float Length = Normal.Length();
+    if(Length <= std::numeric_limits<float>::min())
+        return;
+
+    Normal = Normal / Length;
+    vec3 Positions[3] = {A, B, C};
+    for(uint32_t Idx = 0; Idx < 3; ++Idx)
+    {
+        vertex Vertex;
+        Vertex.Pos = vec4(Positions[Idx], 1.0f);
+        Vertex.Norm = Normal;
+        Vertex.Col = Color;
+        Result.VertexIndices.push_back((uint32_t)Result.Vertices.size());
+        Result.Vertices.push_back(Vertex);
+    }
+}
+
+void
+SweepConvexShape(const convex_shape& Shape, mat4 Transform, vec3 Translation, vec3 Color, mesh& Result)
+{
+    uint64_t GeometryVersion = Result.GeometryVersion + 1;
+    Result = {};
+    Result.Model = Identity();
+    Result.GeometryVersion = GeometryVersion;
+
+    std::vector<vec3> Start(Shape.Points.size());
+    std::vector<vec3> End(Shape.Points.size());
+    for(size_t Idx = 0; Idx < Shape.Points.size(); ++Idx)
+    {
+        Start[Idx] = ConvexTransformPoint(Transform, Shape.Points[Idx]);
+        End[Idx] = Start[Idx] + Translation;
+    }
+
+    // NOTE: directed edge to whether its triangle faces the translation. The same edge of the
+    // neighbour triangle goes the other way
+    uint32_t TriangleCount = (uint32_t)(Shape.Triangles.size() / 3);
+    std::vector<uint8_t> IsFront(TriangleCount);
+    std::unordered_map<uint64_t, uint8_t> EdgeIsFront;
+    EdgeIsFront.reserve(Shape.Triangles.size());
+    Result.Vertices.reserve(Shape.Triangles.size() * 2);
+    Result.VertexIndices.reserve(Shape.Triangles.size() * 2);
+    for(uint32_t TriangleIdx = 0; TriangleIdx < TriangleCount; ++TriangleIdx)
+    {
+        const uint32_t* I = &Shape.Triangles[TriangleIdx * 3];
+        vec3 Normal = Cross(Start[I[1]] - Start[I[0]], Start[I[2]] - Start[I[0]]);
+        IsFront[TriangleIdx] = Normal.Dot(Translation) > 0;
+
+        const std::vector<vec3>& Positions = IsFront[TriangleIdx] ? End : Start;
+        SweepAddTriangle(Result, Positions[I[0]], Positions[I[1]], Positions[I[2]], Color);
+        for(uint32_t Corner = 0; Corner < 3; ++Corner)
+            EdgeIsFront[((uint64_t)I[Corner] << 32) | I[(Corner + 1) % 3]] = IsFront[TriangleIdx];
+    }
+
+    for(uint32_t TriangleIdx = 0; TriangleIdx < TriangleCount; ++TriangleIdx)
+    {
+        if(!IsFront[TriangleIdx]) continue;
+
+        const uint32_t* I = &Shape.Triangles[TriangleIdx * 3];
+        for(uint32_t Corner = 0; Corner < 3; ++Corner)
+        {
+            uint32_t A = I[Corner];
+            uint32_t B = I[(Corner + 1) % 3];
+            auto Neighbor = EdgeIsFront.find(((uint64_t)B << 32) | A);
+            if((Neighbor == EdgeIsFront.end()) || Neighbor->second) continue;
+
+            // NOTE: the front triangle goes A to B at the end, the back one B to A at the start
+            SweepAddTriangle(Result, End[B], End[A], Start[A], Color);
+            SweepAddTriangle(Result, End[B], Start[A], Start[B], Color);
+        }
+    }
+}
@@ -0,0 +1,94 @@
+#ifndef CONVEX_H
+#define CONVEX_H
+
+#include "mat_h.hpp"
+#include "mesh.h"
+
+#include <vector>
+
+const uint32_t GJK_MAX_ITERATIONS = 64;
+const uint32_t EPA_MAX_ITERATIONS = 128;
+const uint32_t SWEEP_MAX_ITERATIONS = 32;
+const float SWEEP_DISTANCE_TOLERANCE = 1e-4f;
+
+// NOTE: the convexity test is triangles times points. Meshes with more triangles,
+// like a scanned stock, are taken as not convex and go through the BSP path
+const uint32_t CONVEX_MAX_TRIANGLES = 4096;
+
+// NOTE: unique mesh space positions of a mesh and their edge graph (Neighbors of
+// point Idx are [FirstNeighbor[Idx], FirstNeighbor[Idx + 1])). On a convex mesh the
+// support point can be found by walking the graph from any point, every local
+// maximum is the global one. Triangles are the mesh triangles as point indices.
+// Rebuilt only when the geometry version changes
+struct convex_shape
+{
+    std::vector<vec3> Points;
+    std::vector<uint32_t> FirstNeighbor;
+    std::vector<uint32_t> Neighbors;
+    std::vector<uint32_t> Triangles;
+
+    bool IsConvex = false;
+
+    uint64_t GeometryVersion = 0;
+    bool IsValid = false;
+};
+
+// NOTE: kept between frames for a pair of shapes. The walk for the support points
+// starts from the last ones and the first search direction is the last separating one,
+// so a pair that moved a little converges in a couple of iterations
+struct gjk_cache
+{
+    uint32_t SupportA = 0;
+    uint32_t SupportB = 0;
+    vec3 Direction = vec3(1, 0, 0);
+};
+
+// NOTE: touching does not count as colliding. When colliding, moving B by
+// Normal * Depth separates the shapes (Normal points from A to B).
+// When not colliding, Distance is the distance between them
+struct convex_contact
+{
+    bool IsColliding = false;
+    float Depth = 0;
+    float Distance = 0;
+    vec3 Normal = {};
+    uint32_t IterationCount = 0;
+};
+
+// NOTE: B moving by Translation first touches A after Time * Translation.
+// Normal points from A to B at that point. A hit at Time 0 means they already collide
+struct convex_sweep
+{
+    bool IsHit = false;
+    float Time = 1;
+    vec3 Normal = {};
+    uint32_t IterationCount = 0;
+};
+
+// NOTE: returns true if the shape was rebuilt
+bool UpdateConvexShape(convex_shape& Shape, const mesh& Mesh);
+
+// NOTE: true if every point of the mesh is behind or on the plane of every triangle.
+// False for meshes above CONVEX_MAX_TRIANGLES
+bool IsConvex(const mesh& Mesh);
+
+// NOTE: true if the point is behind the plane of every triangle of a convex mesh,
+// a point on the surface is outside. Vertices are taken as they are, without Model
+bool IsPointInsideConvex(const mesh& Mesh, vec3 Point);
+
+// NOTE: shapes are in mesh space, Transform is their model matrix.
+// GJK decides if they overlap and EPA gives the penetration depth when they do
+convex_contact GJKCollide(const convex_shape& A, mat4 TransformA,
+                          const convex_shape& B, mat4 TransformB, gjk_cache& Cache);
+
+// NOTE: conservative advancement, B is moved by the distance over the speed it closes
+// the gap along the normal with, which can not pass the first contact
+convex_sweep GJKSweep(const convex_shape& A, mat4 TransformA,
+                      const convex_shape& B, mat4 TransformB, vec3 Translation, gjk_cache& Cache);
+
+// NOTE: the solid a convex shape sweeps when it moves by Translation. Triangles facing
+// the translation are at the end, the others at the start, and the edges between the two
+// are stretched to quads. Result is in world space with the Col of every vertex set to Color
+void SweepConvexShape(const convex_shape& Shape, mat4 Transform, vec3 Translation, vec3 Color, mesh& Result);
+
+#endif // CONVEX_H
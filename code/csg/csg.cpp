@@ -0,0 +1,2207 @@
+#include "csg.h"
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <optional>
+
+#include <cmath>
+#include <cstring>
+
+// NOTE: stats of the public call running on this thread. The call sets it for its
+// duration, so the inner functions count into it without passing it around
+static thread_local csg_stats* CurrentStats = nullptr;
+
+// NOTE: a null Stats keeps the one of the outer call, so that an inner public call
+// (BuildBSPTree from MeshSubtract) adds to the stats of the outer one
+struct csg_stats_scope
+{
+    csg_stats* Previous;
+
+    csg_stats_scope(csg_stats* Stats) : Previous(CurrentStats)
+    {
+        if(Stats) CurrentStats = Stats;
+    }
+
+    ~csg_stats_scope()
+    {
+        CurrentStats = Previous;
+    }
+};
+
+void
+AddCSGStats(csg_stats& Stats, const csg_stats& Other)
+{
+    Stats.PolygonsIn     += Other.PolygonsIn;
+    Stats.PolygonsOut    += Other.PolygonsOut;
+    Stats.SplitCalls     += Other.SplitCalls;
+    Stats.SplitFragments += Other.SplitFragments;
+    Stats.NodeCount      += Other.NodeCount;
+    Stats.MaxDepth        = std::max(Stats.MaxDepth, Other.MaxDepth);
+    Stats.DepthCapHits   += Other.DepthCapHits;
+    Stats.VertexLookups  += Other.VertexLookups;
+    Stats.VertexHits     += Other.VertexHits;
+}
+
+vec4
+GetPlaneFromPolygon(const polygon_soup& Polygons, uint32_t Idx)
+{
+    vec4 Plane = {};
+
+    vec3 A = Polygons.GetPos(Idx, 0);
+    vec3 B = Polygons.GetPos(Idx, 1);
+    vec3 C = Polygons.GetPos(Idx, 2);
+
+    vec3 AB = B - A;
+    vec3 AC = C - A;
+    vec3 Normal = Cross(AB, AC).Normalize();
+
+    Plane.xyz = Normal;
+    Plane.w = Normal.Dot(A);
+
+    return Plane;
+}
+
+// NOTE: moves three points of the plane and builds the plane again from them.
+// That keeps the sides of the plane for any invertible affine transform,
+// including non uniform scale, without inverting the matrix
+vec4
+TransformPlane(vec4 Plane, mat4 Transform)
+{
+    vec3 Normal = Plane.xyz;
+    if(Normal.LengthSq() == 0) return Plane;
+
+    vec3 Axis = (fabs(Normal.x) < 0.9f) ? vec3(1, 0, 0) : vec3(0, 1, 0);
+    vec3 U = Cross(Normal, Axis);
+    vec3 V = Cross(Normal, U);
+    vec3 P0 = Normal * Plane.w;
+
+    vec3 A = (Transform * vec4(P0, 1)).xyz;
+    vec3 B = (Transform * vec4(P0 + U, 1)).xyz;
+    vec3 C = (Transform * vec4(P0 + V, 1)).xyz;
+
+    // NOTE: a mirroring transform flips the winding of the moved points
+    vec3 Col0 = vec3(Transform.E11, Transform.E21, Transform.E31);
+    vec3 Col1 = vec3(Transform.E12, Transform.E22, Transform.E32);
+    vec3 Col2 = vec3(Transform.E13, Transform.E23, Transform.E33);
+    float Det = Col0.Dot(Cross(Col1, Col2));
+
+    vec3 NewNormal = Cross(B - A, C - A).Normalize();
+    if(Det < 0) NewNormal = NewNormal * -1.0f;
+
+    vec4 Result = {};
+    Result.xyz = NewNormal;
+    Result.w = NewNormal.Dot(A);
+    return Result;
+}
+
+struct split_score
+{
+    float Score;
+    int NumInFront;
+    int NumBehind;
+    int NumStraddling;
+};
+
+split_score
+ScoreSplitingPlane(const polygon_soup& Polygons, vec4 Plane, uint32_t PlaneIdx, float BestScore)
+{
+    split_score Result = {};
+    const float BlendFactor = 0.8f;
+
+    int PolygonCount = (int)Polygons.Size() - (PlaneIdx < Polygons.Size() ? 1 : 0);
+    int NumClassified = 0;
+
+    // NOTE: polygons are classified in blocks. The bound below can only grow,
+    // so checking it once per block prunes exactly the same candidates
+    const uint32_t BlockSize = 64;
+    uint8_t Classes[BlockSize];
+    for(uint32_t BlockStart = 0;
+        BlockStart < Polygons.Size();
+        BlockStart += BlockSize)
+    {
+        uint32_t BlockCount = std::min<uint32_t>(BlockSize, Polygons.Size() - BlockStart);
+        ClassifyPolygonsToPlane(Polygons, BlockStart, BlockCount, Plane, Classes);
+
+        for(uint32_t j = BlockStart;
+            j < BlockStart + BlockCount;
+            j++)
+        {
+            if(PlaneIdx == j) continue;
+
+            switch(Classes[j - BlockStart])
+            {
+                case POLYGON_COPLANAR_WITH_PLANE: // NOTE: Coplanar with the plane
+                {
+                    Result.NumInFront++;
+                } break;
+                case POLYGON_IN_FRONT_OF_PLANE: // NOTE: In front of the plane
+                {
+                    Result.NumInFront++;
+                } break;
+                case POLYGON_BEHIND_PLANE: // NOTE: Behind of the plane
+                {
+                    Result.NumBehind++;
+                } break;
+                case POLYGON_STRADDLING_PLANE: // NOTE: Straddling plane
+                {
+                    Result.NumStraddling++;
+                } break;
+            }
+            NumClassified++;
+        }
+
+        // NOTE: remaining polygons can only even out the balance, so this is
+        // the lower bound of the final score. Stop once it can't win anymore
+        int Imbalance = std::max(abs(Result.NumInFront - Result.NumBehind) - (PolygonCount - NumClassified), 0);
+        if(BlendFactor * Result.NumStraddling + (1.0f - BlendFactor) * Imbalance >= BestScore)
+        {
+            Result.Score = std::numeric_limits<float>::max();
+            return Result;
+        }
+    }
+
+    Result.Score = BlendFactor * Result.NumStraddling + (1.0f - BlendFactor) * abs(Result.NumInFront - Result.NumBehind);
+    return Result;
+}
+
+std::vector<uint32_t>
+GetSplitingCandidates(const polygon_soup& Polygons, const bsp_build_params& Params, uint32_t Depth)
+{
+    std::vector<uint32_t> Result;
+    uint32_t PolygonCount = Polygons.Size();
+    uint32_t CandidateCount = std::clamp(Params.CandidateCount, 1u, PolygonCount);
+
+    // NOTE: seeded only by the input, so that the same polygons always give the same tree
+    std::minstd_rand Rng(Params.Seed ^ (Depth * 0x9e3779b9u) ^ PolygonCount);
+
+    switch(Params.Strategy)
+    {
+        case bsp_split_all:
+        {
+            Result.resize(PolygonCount);
+            std::iota(Result.begin(), Result.end(), 0);
+        } break;
+        case bsp_split_random:
+        {
+            for(uint32_t Idx = 0;
+                Idx < CandidateCount;
+                ++Idx)
+            {
+                Result.push_back(Rng() % PolygonCount);
+            }
+        } break;
+        case bsp_split_axis_aligned:
+        {
+            std::vector<float> Centers(PolygonCount);
+            const std::vector<float>* Streams[3] = {Polygons.X, Polygons.Y, Polygons.Z};
+            for(uint32_t Axis = 0;
+                Axis < 3;
+                ++Axis)
+            {
+                const std::vector<float>* Coords = Streams[Axis];
+                for(uint32_t Idx = 0;
+                    Idx < PolygonCount;
+                    ++Idx)
+                {
+                    Centers[Idx] = (Coords[0][Idx] + Coords[1][Idx] + Coords[2][Idx]) / 3.0f;
+                }
+                std::nth_element(Centers.begin(), Centers.begin() + PolygonCount / 2, Centers.end());
+                float Median = Centers[PolygonCount / 2];
+
+                // NOTE: only polygon planes keep the tree usable for inside/outside tests,
+                // so the candidate is the axis aligned polygon closest to the median
+                uint32_t BestIdx = PolygonCount;
+                float BestDist = std::numeric_limits<float>::max();
+                for(uint32_t Idx = 0;
+                    Idx < PolygonCount;
+                    ++Idx)
+                {
+                    vec4 Plane = GetPlaneFromPolygon(Polygons, Idx);
+                    if(fabs(Plane.E[Axis]) < 0.999f) continue;
+
+                    float Dist = fabs(Plane.w * Plane.E[Axis] - Median);
+                    if(Dist < BestDist)
+                    {
+                        BestDist = Dist;
+                        BestIdx = Idx;
+                    }
+                }
+
+                if(BestIdx != PolygonCount) Result.push_back(BestIdx);
+            }
+
+            if(Result.size()) break;
+        } [[fallthrough]];
+        case bsp_split_stratified:
+        {
+            for(uint32_t Idx = 0;
+                Idx < CandidateCount;
+                ++Idx)
+            {
+                uint32_t Begin = uint64_t(Idx) * PolygonCount / CandidateCount;
+                uint32_t End = uint64_t(Idx + 1) * PolygonCount / CandidateCount;
+                Result.push_back(Begin + Rng() % (End - Begin));
+            }
+        } break;
+    }
+
+    return Result;
+}
+
+vec4
+PickSplitingPlane(const polygon_soup& Polygons, const bsp_build_params& Params, uint32_t Depth)
+{
+    vec4 BestPlane = {};
+    float BestScore = std::numeric_limits<float>::max();
+
+    std::vector<uint32_t> Candidates = GetSplitingCandidates(Polygons, Params, Depth);
+
+    // NOTE: candidates are scored in parallel chunks, each pruning against its own best.
+    // A pruned candidate is worse than an earlier one in the same chunk, so it can't win
+    // in the serial order either, and the loop below picks exactly what the serial one does
+    std::vector<split_score> Scores;
+    if(Params.Pool && (Candidates.size() > 1) && (uint64_t(Candidates.size()) * Polygons.Size() >= (1 << 16)))
+    {
+        Scores.resize(Candidates.size());
+        uint32_t ChunkCount = std::min<uint32_t>(Params.Pool->GetThreadCount() + 1, Candidates.size());
+
+        task_group Group;
+        for(uint32_t ChunkIdx = 0;
+            ChunkIdx < ChunkCount;
+            ++ChunkIdx)
+        {
+            uint32_t Begin = uint64_t(ChunkIdx) * Candidates.size() / ChunkCount;
+            uint32_t End = uint64_t(ChunkIdx + 1) * Candidates.size() / ChunkCount;
+            Params.Pool->Submit(Group, [&Polygons, &Candidates, &Scores, Begin, End]()
+            {
+                float ChunkBestScore = std::numeric_limits<float>::max();
+                for(uint32_t Idx = Begin;
+                    Idx < End;
+                    ++Idx)
+                {
+                    vec4 Plane = GetPlaneFromPolygon(Polygons, Candidates[Idx]);
+                    Scores[Idx] = ScoreSplitingPlane(Polygons, Plane, Candidates[Idx], ChunkBestScore);
+                    ChunkBestScore = std::min(ChunkBestScore, Scores[Idx].Score);
+                }
+            });
+        }
+        Params.Pool->Wait(Group);
+    }
+
+    for(uint32_t Idx = 0;
+        Idx < Candidates.size();
+        ++Idx)
+    {
+        uint32_t PlaneIdx = Candidates[Idx];
+        vec4 Plane = GetPlaneFromPolygon(Polygons, PlaneIdx);
+
+        split_score Score = Scores.size() ? Scores[Idx] : ScoreSplitingPlane(Polygons, Plane, PlaneIdx, BestScore);
+        if(Score.Score < BestScore)
+        {
+            BestScore = Score.Score;
+            BestPlane = Plane;
+
+            if(Params.StopAtZeroStraddle && (Score.NumStraddling == 0) && (Score.NumInFront != 0) && (Score.NumBehind != 0))
+                break;
+        }
+    }
+
+    return BestPlane;
+}
+
+vec3
+EdgePlaneIntersection(vec3 A, vec3 B, vec4 Plane, float& t)
+{
+    vec3 Result = {};
+    vec3 AB = B - A;
+    vec3 Normal = Plane.xyz;
+    t = (Plane.w - Normal.Dot(A)) / Normal.Dot(AB);
+    Result = A + AB * t;
+
+    return Result;
+}
+
+// NOTE: written as A + (B - A) * t so that equal attributes stay bit exact
+// and flat shaded polygons keep their normal. Interpolated normals are
+// normalized again, a lerp between two unit vectors is shorter than 1
+vertex_attribs
+LerpVertexAttribs(vertex_attribs A, vertex_attribs B, float t)
+{
+    vertex_attribs Result;
+    Result.Norm = A.Norm + (B.Norm - A.Norm) * t;
+    Result.Col  = A.Col  + (B.Col  - A.Col)  * t;
+    if(!(A.Norm == B.Norm))
+    {
+        Result.Norm.Normalize();
+    }
+
+    return Result;
+}
+
+// NOTE: every vertex of a triangle adds at most 2 vertices to a side
+const uint32_t SPLIT_MAX_VERTS = 6;
+
+struct split_verts
+{
+    vec3 Pos[SPLIT_MAX_VERTS];
+    vertex_attribs Attribs[SPLIT_MAX_VERTS];
+    uint32_t Count = 0;
+
+    void Push(vec3 NewPos, const vertex_attribs& NewAttribs)
+    {
+        Pos[Count] = NewPos;
+        Attribs[Count] = NewAttribs;
+        Count++;
+    }
+};
+
+void
+PushSplitFragment(const split_verts& Verts, polygon_soup& Polygons)
+{
+    if(Verts.Count == 3)
+    {
+        Polygons.Push(Verts.Pos[0], Verts.Pos[1], Verts.Pos[2], Verts.Attribs[0], Verts.Attribs[1], Verts.Attribs[2]);
+    }
+    else if(Verts.Count == 4)
+    {
+        Polygons.Push(Verts.Pos[0], Verts.Pos[1], Verts.Pos[2], Verts.Attribs[0], Verts.Attribs[1], Verts.Attribs[2]);
+        Polygons.Push(Verts.Pos[0], Verts.Pos[2], Verts.Pos[3], Verts.Attribs[0], Verts.Attribs[2], Verts.Attribs[3]);
+    }
+}
+
+// NOTE: fragments are collected on the stack and appended straight to the output
+// soups, so a split only allocates when FrontPolygons or BackPolygons have to grow.
+// That is counted in their GrowCount. Normals and colors of the new vertices
+// are interpolated along the cut edge
+void
+SplitPolygon(const polygon_soup& Polygons, uint32_t PolyIdx, vec4 SplitPlane, polygon_soup& FrontPolygons, polygon_soup& BackPolygons)
+{
+    split_verts FrontVerts;
+    split_verts BackVerts;
+    uint32_t OutputCount = FrontPolygons.Size() + BackPolygons.Size();
+
+    vec3 Prev = Polygons.GetPos(PolyIdx, 2);
+    vertex_attribs PrevAttribs = Polygons.Attribs[PolyIdx * 3 + 2];
+    uint32_t PrevSide = ClassifyPointToPlane(Prev, SplitPlane);
+    for(int VertIdx = 0;
+        VertIdx < 3;
+        ++VertIdx)
+    {
+        vec3 Curr = Polygons.GetPos(PolyIdx, VertIdx);
+        vertex_attribs CurrAttribs = Polygons.Attribs[PolyIdx * 3 + VertIdx];
+        uint32_t CurrSide = ClassifyPointToPlane(Curr, SplitPlane);
+        if(CurrSide == POINT_IN_FRONT_OF_PLANE)
+        {
+            if(PrevSide == POINT_BEHIND_PLANE)
+            {
+                float t;
+                vec3 I = EdgePlaneIntersection(Curr, Prev, SplitPlane, t);
+                vertex_attribs IAttribs = LerpVertexAttribs(CurrAttribs, PrevAttribs, t);
+                //assert(ClassifyPointToPlane(I, SplitPlane) == POINT_ON_PLANE);
+                BackVerts.Push(I, IAttribs);
+                FrontVerts.Push(I, IAttribs);
+            }
+            FrontVerts.Push(Curr, CurrAttribs);
+        }
+        else if(CurrSide == POINT_BEHIND_PLANE)
+        {
+            if(PrevSide == POINT_IN_FRONT_OF_PLANE)
+            {
+                float t;
+                vec3 I = EdgePlaneIntersection(Prev, Curr, SplitPlane, t);
+                vertex_attribs IAttribs = LerpVertexAttribs(PrevAttribs, CurrAttribs, t);
+                //assert(ClassifyPointToPlane(I, SplitPlane) == POINT_ON_PLANE);
+                FrontVerts.Push(I, IAttribs);
+                BackVerts.Push(I, IAttribs);
+            }
+            else if(PrevSide == POINT_ON_PLANE)
+            {
+                BackVerts.Push(Prev, PrevAttribs);
+            }
+            BackVerts.Push(Curr, CurrAttribs);
+        }
+        else  if(CurrSide == POINT_ON_PLANE)
+        {
+            FrontVerts.Push(Curr, CurrAttribs);
+            if(PrevSide == POINT_BEHIND_PLANE)
+            {
+                BackVerts.Push(Curr, CurrAttribs);
+            }
+
+        }
+        Prev = Curr;
+        PrevAttribs = CurrAttribs;
+        PrevSide = CurrSide;
+    }
+
+    PushSplitFragment(FrontVerts, FrontPolygons);
+    PushSplitFragment(BackVerts, BackPolygons);
+
+    if(CurrentStats)
+    {
+        CurrentStats->SplitCalls++;
+        CurrentStats->SplitFragments += FrontPolygons.Size() + BackPolygons.Size() - OutputCount;
+    }
+}
+
+
+// NOTE: sizes Front and Back for the worst case of the classified polygons,
+// a split gives at most 2 polygons on each side. Coplanar is the soup the coplanar
+// polygons are pushed to, it may be Front or Back. A soup that collects the polygons
+// of many nodes (the polygons of a tree) grows by doubling and not to the exact size.
+// After this, pushing into the given soups does not allocate. Coplanar polygons that
+// are pushed to one side or the other by facing are not covered
+void
+BSPReserveSplitOutput(const std::vector<uint8_t>& Classes, polygon_soup& Front, polygon_soup& Back,
+                      polygon_soup* Coplanar = nullptr)
+{
+    uint32_t ClassCounts[4] = {};
+    for(uint8_t Class : Classes) ClassCounts[Class]++;
+
+    uint32_t FrontCount = ClassCounts[POLYGON_IN_FRONT_OF_PLANE] + 2 * ClassCounts[POLYGON_STRADDLING_PLANE];
+    uint32_t BackCount = ClassCounts[POLYGON_BEHIND_PLANE] + 2 * ClassCounts[POLYGON_STRADDLING_PLANE];
+    uint32_t CoplanarCount = ClassCounts[POLYGON_COPLANAR_WITH_PLANE];
+    if(Coplanar == &Front)
+    {
+        FrontCount += CoplanarCount;
+    }
+    else if(Coplanar == &Back)
+    {
+        BackCount += CoplanarCount;
+    }
+    else if(Coplanar && (Coplanar->Size() + CoplanarCount > Coplanar->Capacity()))
+    {
+        Coplanar->Grow(Coplanar->Size() + CoplanarCount);
+    }
+
+    Front.Reserve(Front.Size() + FrontCount);
+    Back.Reserve(Back.Size() + BackCount);
+}
+
+// NOTE: Sources[Idx] is the query polygon that Polygons[Idx] is a part of.
+// Each subtree only gets the parts on its side of the node plane, the back side
+// goes first as that is where the solid is. Without IsInContact the walk stops
+// at the first part inside of the solid, with it a polygon stops once it is marked
+bool
+BSPCollisionNode(const bsp_tree& Tree, uint32_t NodeIdx, const polygon_soup& Polygons,
+                 const std::vector<uint32_t>& Sources, std::vector<uint8_t>* IsInContact)
+{
+    const bsp_node& Node = Tree.Nodes[NodeIdx];
+    vec4 Plane = Node.Plane;
+    polygon_soup Front, Back;
+    std::vector<uint32_t> FrontSources, BackSources;
+
+    std::vector<uint8_t> Classes(Polygons.Size());
+    ClassifyPolygonsToPlane(Polygons, 0, Polygons.Size(), Plane, Classes.data());
+    BSPReserveSplitOutput(Classes, Front, Back, &Front);
+    FrontSources.reserve(Front.Capacity());
+    BackSources.reserve(Back.Capacity());
+
+    for(uint32_t Idx = 0;
+        Idx < Polygons.Size();
+        ++Idx)
+    {
+        if(IsInContact && (*IsInContact)[Sources[Idx]]) continue;
+
+        switch(Classes[Idx])
+        {
+            // NOTE: a polygon lying on the surface only touches the solid
+            case POLYGON_COPLANAR_WITH_PLANE:
+            case POLYGON_IN_FRONT_OF_PLANE:
+            {
+                Front.Push(Polygons, Idx);
+                FrontSources.push_back(Sources[Idx]);
+            } break;
+            case POLYGON_BEHIND_PLANE:
+            {
+                Back.Push(Polygons, Idx);
+                BackSources.push_back(Sources[Idx]);
+            } break;
+            case POLYGON_STRADDLING_PLANE:
+            {
+                SplitPolygon(Polygons, Idx, Plane, Front, Back);
+                FrontSources.resize(Front.Size(), Sources[Idx]);
+                BackSources.resize(Back.Size(), Sources[Idx]);
+            } break;
+        }
+    }
+
+    bool Result = false;
+    if(Back.Size())
+    {
+        if(Node.Back == BSP_NULL_NODE)
+        {
+            if(!IsInContact) return true;
+            for(uint32_t Source : BackSources) (*IsInContact)[Source] = 1;
+            Result = true;
+        }
+        else
+        {
+            Result = BSPCollisionNode(Tree, Node.Back, Back, BackSources, IsInContact);
+            if(Result && !IsInContact) return true;
+        }
+    }
+
+    if(Front.Size() && (Node.Front != BSP_NULL_NODE))
+        Result |= BSPCollisionNode(Tree, Node.Front, Front, FrontSources, IsInContact);
+
+    return Result;
+}
+
+// NOTE: true if a part of a polygon is inside of the solid of the tree.
+// If Contacts is given, it gets the indices of all such polygons,
+// otherwise the walk stops as soon as the first one is found
+bool
+BSPCollision(const bsp_tree& Tree, const polygon_soup& Polygons, std::vector<uint32_t>* Contacts)
+{
+    if(Contacts) Contacts->clear();
+    if(Tree.Nodes.empty() || (Polygons.Size() == 0)) return false;
+
+    std::vector<uint32_t> Sources(Polygons.Size());
+    std::iota(Sources.begin(), Sources.end(), 0);
+
+    if(!Contacts) return BSPCollisionNode(Tree, 0, Polygons, Sources, nullptr);
+
+    std::vector<uint8_t> IsInContact(Polygons.Size(), 0);
+    bool Result = BSPCollisionNode(Tree, 0, Polygons, Sources, &IsInContact);
+    for(uint32_t Idx = 0;
+        Idx < Polygons.Size();
+        ++Idx)
+    {
+        if(IsInContact[Idx]) Contacts->push_back(Idx);
+    }
+
+    return Result;
+}
+
+// NOTE: Contacts are triangle indices of the mesh
+bool
+BSPCollision(const bsp_tree& Tree, mesh& Mesh, std::vector<uint32_t>* Contacts)
+{
+    polygon_soup Polygons = Mesh.GeneratePolygons(Mesh.VertexIndices);
+    return BSPCollision(Tree, Polygons, Contacts);
+}
+
+// NOTE: a point on a node plane is inside only if it is on both sides,
+// so a point on the surface is outside. A leaf without a plane (made at
+// MaxDepth of the build) has the point on its plane and no children, which is outside
+static bool
+BSPIsPointInsideNode(const bsp_tree& Tree, uint32_t NodeIdx, vec3 Point)
+{
+    const bsp_node& Node = Tree.Nodes[NodeIdx];
+    uint32_t Side = ClassifyPointToPlane(Point, Node.Plane);
+
+    bool IsInFront = false;
+    bool IsBehind = true;
+    if(Side != POINT_BEHIND_PLANE)
+        IsInFront = (Node.Front != BSP_NULL_NODE) && BSPIsPointInsideNode(Tree, Node.Front, Point);
+    if(Side != POINT_IN_FRONT_OF_PLANE)
+        IsBehind = (Node.Back == BSP_NULL_NODE) || BSPIsPointInsideNode(Tree, Node.Back, Point);
+
+    if(Side == POINT_IN_FRONT_OF_PLANE) return IsInFront;
+    if(Side == POINT_BEHIND_PLANE) return IsBehind;
+    return IsInFront && IsBehind;
+}
+
+bool
+BSPIsPointInside(const bsp_tree& Tree, vec3 Point)
+{
+    if(Tree.Nodes.empty()) return false;
+    return BSPIsPointInsideNode(Tree, 0, Point);
+}
+
+// NOTE: only vertices in Bounds are tested, the rest can not be inside of a solid in them
+bool
+BSPIsAnyVertexInside(const bsp_tree& Tree, const mesh& Mesh, const aabb& Bounds)
+{
+    for(const vertex& Vertex : Mesh.Vertices)
+    {
+        vec3 Point = vec3(Vertex.Pos.x, Vertex.Pos.y, Vertex.Pos.z);
+        if((Point.x < Bounds.Min.x) || (Point.y < Bounds.Min.y) || (Point.z < Bounds.Min.z) ||
+           (Point.x > Bounds.Max.x) || (Point.y > Bounds.Max.y) || (Point.z > Bounds.Max.z))
+            continue;
+        if(BSPIsPointInside(Tree, Point)) return true;
+    }
+    return false;
+}
+
+uint32_t
+BSPPushNode(bsp_tree& Tree, vec4 Plane)
+{
+    bsp_node Node = {};
+    Node.Plane = Plane;
+    Node.FirstPolygon = Tree.Polygons.Size();
+    Node.PolygonCount = 0;
+    Node.Front = BSP_NULL_NODE;
+    Node.Back  = BSP_NULL_NODE;
+    Tree.Nodes.push_back(Node);
+    if(CurrentStats) CurrentStats->NodeCount++;
+
+    return Tree.Nodes.size() - 1;
+}
+
+// NOTE: copies all nodes and polygons of SubTree to the end of Tree.
+// Returns the new index of the SubTree root
+uint32_t
+BSPAppendTree(bsp_tree& Tree, const bsp_tree& SubTree)
+{
+    if(SubTree.Nodes.empty()) return BSP_NULL_NODE;
+
+    uint32_t NodeOffset = Tree.Nodes.size();
+    uint32_t PolygonOffset = Tree.Polygons.Size();
+    for(bsp_node Node : SubTree.Nodes)
+    {
+        Node.FirstPolygon += PolygonOffset;
+        if(Node.Front != BSP_NULL_NODE) Node.Front += NodeOffset;
+        if(Node.Back  != BSP_NULL_NODE) Node.Back  += NodeOffset;
+        Tree.Nodes.push_back(Node);
+    }
+    Tree.Polygons.Append(SubTree.Polygons);
+
+    return NodeOffset;
+}
+
+uint32_t
+BuildBSPNode(const polygon_soup& Polygons, bsp_tree& Tree, const bsp_build_params& Params, uint32_t Depth)
+{
+    if(Polygons.Size() == 0) return BSP_NULL_NODE;
+
+    if(CurrentStats) CurrentStats->MaxDepth = std::max(CurrentStats->MaxDepth, Depth);
+    if(Depth >= Params.MaxDepth)
+    {
+        if(CurrentStats) CurrentStats->DepthCapHits++;
+        uint32_t NodeIdx = BSPPushNode(Tree, {});
+        Tree.Polygons.Append(Polygons);
+        Tree.Nodes[NodeIdx].PolygonCount = Polygons.Size();
+        return NodeIdx;
+    }
+
+    polygon_soup Front, Back;
+
+    vec4 SplitPlane = PickSplitingPlane(Polygons, Params, Depth);
+    uint32_t NodeIdx = BSPPushNode(Tree, SplitPlane);
+
+    std::vector<uint8_t> Classes(Polygons.Size());
+    ClassifyPolygonsToPlane(Polygons, 0, Polygons.Size(), SplitPlane, Classes.data());
+    BSPReserveSplitOutput(Classes, Front, Back, &Tree.Polygons);
+
+    for(uint32_t i = 0;
+        i < Polygons.Size();
+        i++)
+    {
+        switch(Classes[i])
+        {
+            case POLYGON_COPLANAR_WITH_PLANE:
+            {
+                Tree.Polygons.Push(Polygons, i);
+            } break;
+            case POLYGON_IN_FRONT_OF_PLANE:
+            {
+                Front.Push(Polygons, i);
+            } break;
+            case POLYGON_BEHIND_PLANE:
+            {
+                Back.Push(Polygons, i);
+            } break;
+            case POLYGON_STRADDLING_PLANE:
+            {
+                SplitPolygon(Polygons, i, SplitPlane, Front, Back);
+            } break;
+        }
+    }
+    Tree.Nodes[NodeIdx].PolygonCount = Tree.Polygons.Size() - Tree.Nodes[NodeIdx].FirstPolygon;
+
+    uint32_t FrontIdx = BSP_NULL_NODE;
+    uint32_t BackIdx  = BSP_NULL_NODE;
+    if(Params.Pool && (std::min(Front.Size(), Back.Size()) >= Params.ParallelCutoff))
+    {
+        // NOTE: subtrees are built apart and then appended in the serial order,
+        // so that the layout is the same as the one of the serial build
+        // The task counts into its own stats, which are added after the wait
+        bsp_tree FrontTree;
+        bsp_tree BackTree;
+        csg_stats FrontStats;
+
+        task_group Group;
+        Params.Pool->Submit(Group, [&]()
+        {
+            csg_stats_scope StatsScope(&FrontStats);
+            BuildBSPNode(Front, FrontTree, Params, Depth + 1);
+        });
+        BuildBSPNode(Back, BackTree, Params, Depth + 1);
+        Params.Pool->Wait(Group);
+        if(CurrentStats) AddCSGStats(*CurrentStats, FrontStats);
+
+        FrontIdx = BSPAppendTree(Tree, FrontTree);
+        BackIdx  = BSPAppendTree(Tree, BackTree);
+    }
+    else
+    {
+        FrontIdx = BuildBSPNode(Front, Tree, Params, Depth + 1);
+        BackIdx  = BuildBSPNode(Back, Tree, Params, Depth + 1);
+    }
+
+    Tree.Nodes[NodeIdx].Front = FrontIdx;
+    Tree.Nodes[NodeIdx].Back  = BackIdx;
+
+    return NodeIdx;
+}
+
+bsp_tree
+BuildBSPTree(const polygon_soup& Polygons, const bsp_build_params& Params, csg_stats* Stats)
+{
+    csg_stats_scope StatsScope(Stats);
+
+    bsp_tree Result;
+    BuildBSPNode(Polygons, Result, Params, 0);
+
+    if(Stats)
+    {
+        Stats->PolygonsIn  += Polygons.Size();
+        Stats->PolygonsOut += Result.Polygons.Size();
+    }
+    return Result;
+}
+
+// NOTE: nodes can't grow in place, so the tree is copied into Result with the polygons
+// inserted along the way. Polygons that go to the side which is not kept are dropped
+uint32_t
+BSPInsertNode(const bsp_tree& Tree, uint32_t NodeIdx, const polygon_soup& Polygons, bsp_tree& Result, bool KeepFront, bool KeepBack)
+{
+    bool IsNewNode = NodeIdx == BSP_NULL_NODE;
+    if(IsNewNode && (Polygons.Size() == 0)) return BSP_NULL_NODE;
+
+    vec4 SplitPlane = IsNewNode ? vec4{} : Tree.Nodes[NodeIdx].Plane;
+    uint32_t NewIdx = BSPPushNode(Result, SplitPlane);
+    if(!IsNewNode)
+    {
+        const bsp_node& Node = Tree.Nodes[NodeIdx];
+        Result.Polygons.Append(Tree.Polygons, Node.FirstPolygon, Node.PolygonCount);
+    }
+
+    polygon_soup Front, Back;
+
+    std::vector<uint8_t> Classes(Polygons.Size());
+    ClassifyPolygonsToPlane(Polygons, 0, Polygons.Size(), SplitPlane, Classes.data());
+    BSPReserveSplitOutput(Classes, Front, Back, &Result.Polygons);
+
+    for(uint32_t i = 0;
+        i < Polygons.Size();
+        i++)
+    {
+
+        switch(Classes[i])
+        {
+            case POLYGON_COPLANAR_WITH_PLANE:
+            {
+                Result.Polygons.Push(Polygons, i);
+            }break;
+            case POLYGON_IN_FRONT_OF_PLANE:
+            {
+                if(KeepFront) Front.Push(Polygons, i);
+            } break;
+            case POLYGON_BEHIND_PLANE:
+            {
+                if(KeepBack) Back.Push(Polygons, i);
+            } break;
+            case POLYGON_STRADDLING_PLANE:
+            {
+                SplitPolygon(Polygons, i, SplitPlane, Front, Back);
+            } break;
+        }
+    }
+    Result.Nodes[NewIdx].PolygonCount = Result.Polygons.Size() - Result.Nodes[NewIdx].FirstPolygon;
+
+    uint32_t FrontIdx = IsNewNode ? BSP_NULL_NODE : Tree.Nodes[NodeIdx].Front;
+    uint32_t BackIdx  = IsNewNode ? BSP_NULL_NODE : Tree.Nodes[NodeIdx].Back;
+
+    FrontIdx = BSPInsertNode(Tree, FrontIdx, Front, Result, KeepFront, KeepBack);
+    BackIdx  = BSPInsertNode(Tree, BackIdx, Back, Result, KeepFront, KeepBack);
+    Result.Nodes[NewIdx].Front = FrontIdx;
+    Result.Nodes[NewIdx].Back  = BackIdx;
+
+    return NewIdx;
+}
+
+void BSPInsert(bsp_tree& Tree, const polygon_soup& Polygons)
+{
+    if(Polygons.Size() == 0) return;
+    if(Tree.Nodes.empty()) return;
+
+    bsp_tree Result;
+    BSPInsertNode(Tree, 0, Polygons, Result, true, true);
+    Tree = std::move(Result);
+}
+
+void BSPInsertInner(bsp_tree& Tree, const polygon_soup& Polygons)
+{
+    if(Polygons.Size() == 0) return;
+    if(Tree.Nodes.empty()) return;
+
+    bsp_tree Result;
+    BSPInsertNode(Tree, 0, Polygons, Result, false, true);
+    Tree = std::move(Result);
+}
+
+void BSPInsertOuter(bsp_tree& Tree, const polygon_soup& Polygons)
+{
+    if(Polygons.Size() == 0) return;
+    if(Tree.Nodes.empty()) return;
+
+    bsp_tree Result;
+    BSPInsertNode(Tree, 0, Polygons, Result, true, false);
+    Tree = std::move(Result);
+}
+
+std::optional<polygon_soup>
+BSPInsertCreateBack1(const bsp_tree& Tree, const polygon_soup& Polygons, uint32_t NodeIdx = 0)
+{
+    if(Polygons.Size() == 0) return {};
+    if(NodeIdx >= Tree.Nodes.size()) return {};
+
+    const bsp_node& Node = Tree.Nodes[NodeIdx];
+    vec4 SplitPlane = Node.Plane;
+    polygon_soup Front, Back, Result;
+
+    std::vector<uint8_t> Classes(Polygons.Size());
+    ClassifyPolygonsToPlane(Polygons, 0, Polygons.Size(), SplitPlane, Classes.data());
+    BSPReserveSplitOutput(Classes, Front, Back, &Front);
+
+    for(uint32_t i = 0;
+        i < Polygons.Size();
+        i++)
+    {
+
+        switch(Classes[i])
+        {
+            case POLYGON_COPLANAR_WITH_PLANE:
+            {
+                Front.Push(Polygons, i);
+            }break;
+            case POLYGON_IN_FRONT_OF_PLANE:
+            {
+                Front.Push(Polygons, i);
+            } break;
+            case POLYGON_BEHIND_PLANE:
+            {
+                Back.Push(Polygons, i);
+            } break;
+            case POLYGON_STRADDLING_PLANE:
+            {
+                SplitPolygon(Polygons, i, SplitPlane, Front, Back);
+            } break;
+        }
+    }
+
+    if(Node.Front != BSP_NULL_NODE)
+    {
+        auto Ret = BSPInsertCreateBack1(Tree, Front, Node.Front);
+        if(Ret) Result.Append(*Ret);
+    }
+
+    if(Node.Back != BSP_NULL_NODE)
+    {
+        auto Ret = BSPInsertCreateBack1(Tree, Back, Node.Back);
+        if(Ret) Result.Append(*Ret);
+    }
+    else
+    {
+        return Back;
+    }
+
+    return Result;
+}
+
+uint32_t
+BSPInsertCreateBackNode(const bsp_tree& Tree, uint32_t NodeIdx, const polygon_soup& Polygons, bsp_tree& Result)
+{
+    if(Polygons.Size() == 0) return BSP_NULL_NODE;
+
+    const bsp_node& Node = Tree.Nodes[NodeIdx];
+    polygon_soup Front, Back;
+    vec4 SplitPlane = Node.Plane;
+
+    std::vector<uint8_t> Classes(Polygons.Size());
+    ClassifyPolygonsToPlane(Polygons, 0, Polygons.Size(), SplitPlane, Classes.data());
+    BSPReserveSplitOutput(Classes, Front, Back, &Front);
+
+    for(uint32_t i = 0;
+        i < Polygons.Size();
+        i++)
+    {
+
+        switch(Classes[i])
+        {
+            case POLYGON_COPLANAR_WITH_PLANE:
+            {
+                Front.Push(Polygons, i);
+            }break;
+            case POLYGON_IN_FRONT_OF_PLANE:
+            {
+                Front.Push(Polygons, i);
+            } break;
+            case POLYGON_BEHIND_PLANE:
+            {
+                Back.Push(Polygons, i);
+            } break;
+            case POLYGON_STRADDLING_PLANE:
+            {
+                SplitPolygon(Polygons, i, SplitPlane, Front, Back);
+            } break;
+        }
+    }
+
+    uint32_t NewIdx = BSPPushNode(Result, SplitPlane);
+    Result.Polygons.Append(Back);
+    Result.Nodes[NewIdx].PolygonCount = Back.Size();
+
+    uint32_t FrontIdx = BSP_NULL_NODE;
+    uint32_t BackIdx  = BSP_NULL_NODE;
+    if(Node.Front != BSP_NULL_NODE)
+        FrontIdx = BSPInsertCreateBackNode(Tree, Node.Front, Front, Result);
+    if(Node.Back != BSP_NULL_NODE)
+        BackIdx = BSPInsertCreateBackNode(Tree, Node.Back, Back, Result);
+    Result.Nodes[NewIdx].Front = FrontIdx;
+    Result.Nodes[NewIdx].Back  = BackIdx;
+
+    return NewIdx;
+}
+
+bsp_tree
+BSPInsertCreateBack(const bsp_tree& Tree, const polygon_soup& Polygons)
+{
+    bsp_tree Result;
+    if(Tree.Nodes.empty()) return Result;
+
+    BSPInsertCreateBackNode(Tree, 0, Polygons, Result);
+    return Result;
+}
+
+std::optional<polygon_soup>
+BSPInsertCreateFront1(const bsp_tree& Tree, const polygon_soup& Polygons, uint32_t NodeIdx = 0)
+{
+    if(Polygons.Size() == 0) return {};
+    if(NodeIdx >= Tree.Nodes.size()) return {};
+
+    const bsp_node& Node = Tree.Nodes[NodeIdx];
+    vec4 SplitPlane = Node.Plane;
+    polygon_soup Front, Back, Result;
+
+    std::vector<uint8_t> Classes(Polygons.Size());
+    ClassifyPolygonsToPlane(Polygons, 0, Polygons.Size(), SplitPlane, Classes.data());
+    BSPReserveSplitOutput(Classes, Front, Back, &Front);
+
+    for(uint32_t i = 0;
+        i < Polygons.Size();
+        i++)
+    {
+
+        switch(Classes[i])
+        {
+            case POLYGON_COPLANAR_WITH_PLANE:
+            {
+                Front.Push(Polygons, i);
+            }break;
+            case POLYGON_IN_FRONT_OF_PLANE:
+            {
+                Front.Push(Polygons, i);
+            } break;
+            case POLYGON_BEHIND_PLANE:
+            {
+                Back.Push(Polygons, i);
+            } break;
+            case POLYGON_STRADDLING_PLANE:
+            {
+                SplitPolygon(Polygons, i, SplitPlane, Front, Back);
+            } break;
+        }
+    }
+
+    if(Node.Front != BSP_NULL_NODE)
+    {
+        auto Ret = BSPInsertCreateFront1(Tree, Front, Node.Front);
+        if(Ret) Result.Append(*Ret);
+    }
+
+    if(Node.Back != BSP_NULL_NODE)
+    {
+        auto Ret = BSPInsertCreateFront1(Tree, Back, Node.Back);
+        if(Ret) Result.Append(*Ret);
+    }
+
+    Result.Append(Front);
+
+    return Result;
+}
+
+uint32_t
+BSPInsertCreateFrontNode(const bsp_tree& Tree, uint32_t NodeIdx, const polygon_soup& Polygons, bsp_tree& Result)
+{
+    if(Polygons.Size() == 0) return BSP_NULL_NODE;
+
+    const bsp_node& Node = Tree.Nodes[NodeIdx];
+    polygon_soup Front, Back;
+    vec4 SplitPlane = Node.Plane;
+
+    std::vector<uint8_t> Classes(Polygons.Size());
+    ClassifyPolygonsToPlane(Polygons, 0, Polygons.Size(), SplitPlane, Classes.data());
+    BSPReserveSplitOutput(Classes, Front, Back, &Front);
+
+    for(uint32_t i = 0;
+        i < Polygons.Size();
+        i++)
+    {
+
+        switch(Classes[i])
+        {
+            case POLYGON_COPLANAR_WITH_PLANE:
+            {
+                Front.Push(Polygons, i);
+            }break;
+            case POLYGON_IN_FRONT_OF_PLANE:
+            {
+                Front.Push(Polygons, i);
+            } break;
+            case POLYGON_BEHIND_PLANE:
+            {
+                Back.Push(Polygons, i);
+            } break;
+            case POLYGON_STRADDLING_PLANE:
+            {
+                SplitPolygon(Polygons, i, SplitPlane, Front, Back);
+            } break;
+        }
+    }
+
+    uint32_t NewIdx = BSPPushNode(Result, SplitPlane);
+    Result.Polygons.Append(Front);
+    Result.Nodes[NewIdx].PolygonCount = Front.Size();
+
+    uint32_t FrontIdx = BSP_NULL_NODE;
+    uint32_t BackIdx  = BSP_NULL_NODE;
+    if(Node.Front != BSP_NULL_NODE)
+        FrontIdx = BSPInsertCreateFrontNode(Tree, Node.Front, Front, Result);
+    if(Node.Back != BSP_NULL_NODE)
+        BackIdx = BSPInsertCreateFrontNode(Tree, Node.Back, Back, Result);
+    Result.Nodes[NewIdx].Front = FrontIdx;
+    Result.Nodes[NewIdx].Back  = BackIdx;
+
+    return NewIdx;
+}
+
+bsp_tree
+BSPInsertCreateFront(const bsp_tree& Tree, const polygon_soup& Polygons)
+{
+    bsp_tree Result;
+    if(Tree.Nodes.empty()) return Result;
+
+    BSPInsertCreateFrontNode(Tree, 0, Polygons, Result);
+    return Result;
+}
+
+void BSPMerge(bsp_tree& A, const bsp_tree& B)
+{
+    // NOTE: nodes are stored depth first, so this is the same as walking B recursively
+    for(const bsp_node& Node : B.Nodes)
+    {
+        polygon_soup Polygons;
+        Polygons.Append(B.Polygons, Node.FirstPolygon, Node.PolygonCount);
+        BSPInsert(A, Polygons);
+    }
+}
+
+uint32_t BSPGetIndexCount(const bsp_tree& Tree)
+{
+    uint32_t Result = 0;
+    for(const bsp_node& Node : Tree.Nodes)
+    {
+        Result += Node.PolygonCount * 3;
+    }
+    return Result;
+}
+
+void BSPAccumulateQuality(const bsp_tree& Tree, uint32_t NodeIdx, bsp_tree_quality& Quality, uint32_t Depth)
+{
+    const bsp_node& Node = Tree.Nodes[NodeIdx];
+
+    Quality.NodeCount++;
+    Quality.MaxDepth = std::max(Quality.MaxDepth, Depth);
+    Quality.PolygonCount += Node.PolygonCount;
+    Quality.AverageDepth += float(Depth) * Node.PolygonCount;
+    if((Node.Front == BSP_NULL_NODE) && (Node.Back == BSP_NULL_NODE)) Quality.LeafCount++;
+
+    if(Node.Front != BSP_NULL_NODE) BSPAccumulateQuality(Tree, Node.Front, Quality, Depth + 1);
+    if(Node.Back  != BSP_NULL_NODE) BSPAccumulateQuality(Tree, Node.Back, Quality, Depth + 1);
+}
+
+bsp_tree_quality BSPGetTreeQuality(const bsp_tree& Tree)
+{
+    bsp_tree_quality Result = {};
+    if(Tree.Nodes.empty()) return Result;
+
+    BSPAccumulateQuality(Tree, 0, Result, 0);
+    if(Result.PolygonCount) Result.AverageDepth /= Result.PolygonCount;
+
+    return Result;
+}
+
+// NOTE: moves a built tree instead of building a new one from moved polygons.
+// Nodes and polygon ranges stay the same, only planes and polygons change
+void BSPTransformTree(bsp_tree& Tree, mat4 Transform)
+{
+    for(bsp_node& Node : Tree.Nodes)
+    {
+        Node.Plane = TransformPlane(Node.Plane, Transform);
+    }
+    Tree.Polygons.Transform(Transform);
+}
+
+void TransformVertices(std::vector<vertex>& Vertices, mat4 Transform)
+{
+    mat3 NormalMat = Transform.GetMat3();
+    for(vertex& Vert : Vertices)
+    {
+        Vert.Pos  = Transform * Vert.Pos;
+        Vert.Norm = NormalMat * Vert.Norm;
+    }
+}
+
+// NOTE: nodes level by level from the root, front before back. Vertices are generated
+// in this order, like when the nodes were linked, so a mesh gets the same vertex and
+// index order as before. Nodes whose ranges are not used anymore are not reachable
+static std::vector<uint32_t>
+BSPGetNodesBreadthFirst(const bsp_tree& Tree)
+{
+    std::vector<uint32_t> Order;
+    if(Tree.Nodes.empty()) return Order;
+
+    Order.reserve(Tree.Nodes.size());
+    Order.push_back(0);
+    for(size_t Next = 0;
+        Next < Order.size();
+        ++Next)
+    {
+        const bsp_node& Node = Tree.Nodes[Order[Next]];
+        if(Node.Front != BSP_NULL_NODE) Order.push_back(Node.Front);
+        if(Node.Back  != BSP_NULL_NODE) Order.push_back(Node.Back);
+    }
+
+    return Order;
+}
+
+void BSPGenerateVertices(const bsp_tree& Tree, mesh& Mesh, csg_stats* Stats)
+{
+    PROFILE_SCOPE(profile_generate_vertices);
+    csg_stats_scope StatsScope(Stats);
+
+    std::unordered_map<vertex, uint32_t> UniqueVertices;
+    uint32_t IndexCount = BSPGetIndexCount(Tree);
+    std::vector<uint32_t> Indices(IndexCount);
+
+    uint32_t VertexIndex = 0;
+    for(uint32_t NodeIdx : BSPGetNodesBreadthFirst(Tree))
+    {
+        const bsp_node& Node = Tree.Nodes[NodeIdx];
+        for(uint32_t Idx = Node.FirstPolygon;
+            Idx < Node.FirstPolygon + Node.PolygonCount;
+            ++Idx)
+        {
+            for(uint32_t VertIdx = 0;
+                VertIdx < 3;
+                ++VertIdx)
+            {
+                const vertex_attribs& Attribs = Tree.Polygons.Attribs[Idx * 3 + VertIdx];
+                vertex NewVert;
+                NewVert.Pos  = vec4(Tree.Polygons.GetPos(Idx, VertIdx), 1);
+                NewVert.Norm = Attribs.Norm;
+                NewVert.Col  = Attribs.Col;
+
+                if(UniqueVertices.count(NewVert) == 0)
+                {
+                    UniqueVertices[NewVert] = static_cast<uint32_t>(Mesh.Vertices.size());
+                    Mesh.Vertices.push_back(NewVert);
+                }
+
+                Indices[VertexIndex++] = UniqueVertices[NewVert];
+            }
+        }
+    }
+
+    // NOTE: every index is one lookup, every lookup that did not add a vertex is a hit
+    if(CurrentStats)
+    {
+        CurrentStats->VertexLookups += IndexCount;
+        CurrentStats->VertexHits += IndexCount - UniqueVertices.size();
+    }
+    if(Stats)
+    {
+        Stats->PolygonsIn  += IndexCount / 3;
+        Stats->PolygonsOut += IndexCount / 3;
+    }
+
+    Mesh.VertexIndices = Indices;
+}
+
+mesh
+BSPSubtract(const bsp_tree& ATree, const bsp_tree& BTree, const polygon_soup& APolygons, const polygon_soup& BPolygons,
+            csg_stats* Stats)
+{
+    csg_stats_scope StatsScope(Stats);
+    mesh Result = {};
+
+    bsp_tree A = BSPInsertCreateBack(BTree, APolygons);
+    polygon_soup B = BSPInsertCreateBack1(ATree, BPolygons).value_or(polygon_soup());
+
+    std::unordered_map<vertex, uint32_t> UniqueVertices;
+    uint32_t IndexCount = BSPGetIndexCount(A) + B.Size()*3;
+    std::vector<uint32_t> Indices(IndexCount);
+    uint32_t VertexIndex = 0;
+
+    for(uint32_t NodeIdx : BSPGetNodesBreadthFirst(A))
+    {
+        const bsp_node& Node = A.Nodes[NodeIdx];
+        for(uint32_t Idx = Node.FirstPolygon;
+            Idx < Node.FirstPolygon + Node.PolygonCount;
+            ++Idx)
+        {
+            for(int PolyIdx = 0;
+                PolyIdx < 3;
+                PolyIdx++)
+            {
+                const vertex_attribs& Attribs = A.Polygons.Attribs[Idx * 3 + PolyIdx];
+                vertex NewVert;
+                NewVert.Pos  = vec4(A.Polygons.GetPos(Idx, PolyIdx), 1);
+                NewVert.Norm = Attribs.Norm;
+                NewVert.Col  = Attribs.Col;
+
+                if(UniqueVertices.count(NewVert) == 0)
+                {
+                    UniqueVertices[NewVert] = static_cast<uint32_t>(Result.Vertices.size());
+                    Result.Vertices.push_back(NewVert);
+                }
+
+                Indices[VertexIndex++] = UniqueVertices[NewVert];
+            }
+        }
+    }
+
+    for(uint32_t Idx = 0;
+        Idx < B.Size();
+        ++Idx)
+    {
+        for(int PolyIdx = 2;
+            PolyIdx >= 0;
+            PolyIdx--)
+        {
+            const vertex_attribs& Attribs = B.Attribs[Idx * 3 + PolyIdx];
+            vertex NewVert;
+            NewVert.Pos  = vec4(B.GetPos(Idx, PolyIdx), 1);
+            NewVert.Norm = vec3(-Attribs.Norm.x, -Attribs.Norm.y, -Attribs.Norm.z);
+            NewVert.Col  = Attribs.Col;
+
+            if(UniqueVertices.count(NewVert) == 0)
+            {
+                UniqueVertices[NewVert] = static_cast<uint32_t>(Result.Vertices.size());
+                Result.Vertices.push_back(NewVert);
+            }
+
+            Indices[VertexIndex++] = UniqueVertices[NewVert];
+        }
+    }
+
+    if(CurrentStats)
+    {
+        CurrentStats->VertexLookups += IndexCount;
+        CurrentStats->VertexHits += IndexCount - UniqueVertices.size();
+    }
+    if(Stats)
+    {
+        Stats->PolygonsIn  += APolygons.Size() + BPolygons.Size();
+        Stats->PolygonsOut += IndexCount / 3;
+    }
+
+    Result.VertexIndices = Indices;
+    return Result;
+}
+
+mesh
+MeshSubtract(mesh& A, mesh& B, const bsp_build_params& Params, csg_stats* Stats)
+{
+    PROFILE_SCOPE(profile_subtract);
+    csg_stats_scope StatsScope(Stats);
+
+    mesh Result;
+
+    polygon_soup APolygons = A.GeneratePolygons(A.VertexIndices);
+    polygon_soup BPolygons = B.GeneratePolygons(B.VertexIndices);
+
+    bsp_tree ATree;
+    bsp_tree BTree;
+    if(Params.Pool)
+    {
+        csg_stats AStats;
+        task_group Group;
+        Params.Pool->Submit(Group, [&]()
+        {
+            csg_stats_scope StatsScope(&AStats);
+            ATree = BuildBSPTree(APolygons, Params);
+        });
+        BTree = BuildBSPTree(BPolygons, Params);
+        Params.Pool->Wait(Group);
+        if(CurrentStats) AddCSGStats(*CurrentStats, AStats);
+    }
+    else
+    {
+        ATree = BuildBSPTree(APolygons, Params);
+        BTree = BuildBSPTree(BPolygons, Params);
+    }
+    Result = BSPSubtract(ATree, BTree, APolygons, BPolygons);
+
+    if(Stats)
+    {
+        Stats->PolygonsIn  += APolygons.Size() + BPolygons.Size();
+        Stats->PolygonsOut += Result.VertexIndices.size() / 3;
+    }
+
+    Result.Model = A.Model;
+    return Result;
+}
+
+// NOTE: sets the color of all polygons and vertices, for a mesh of one color. Planes,
+// splits and the merging of vertices do not look at colors, so this is the same as a rebuild
+static void
+BSPSetColor(bsp_tree& Tree, mesh& Generated, vec3 Color)
+{
+    for(vertex_attribs& Attribs : Tree.Polygons.Attribs) Attribs.Col = Color;
+    for(vertex& Vertex : Generated.Vertices) Vertex.Col = Color;
+}
+
+static bool
+IsSingleColor(const mesh& Mesh)
+{
+    return std::all_of(Mesh.Vertices.begin(), Mesh.Vertices.end(),
+                       [&](const vertex& Vertex) { return Vertex.Col == Mesh.Vertices[0].Col; });
+}
+
+// NOTE: returns true if the tree of the cache changed, either rebuilt, moved or recolored
+bool
+UpdateBSPCache(bsp_cache& Cache, mesh& Mesh, const bsp_build_params& Params, csg_stats* Stats)
+{
+    bool IsSameModel = memcmp(Cache.Model.V, Mesh.Model.V, sizeof(Mesh.Model.V)) == 0;
+    bool IsSameGeometry = Cache.IsValid && (Cache.GeometryVersion == Mesh.GeometryVersion);
+    bool IsSameColor = Cache.IsValid && (Cache.ColorVersion == Mesh.ColorVersion);
+    if(IsSameGeometry && IsSameModel && IsSameColor) return false;
+
+    PROFILE_SCOPE(profile_tree_build);
+    csg_stats_scope StatsScope(Stats);
+
+    bool IsRecolored = IsSameGeometry && !IsSameColor && !Mesh.Vertices.empty() && IsSingleColor(Mesh);
+    if(!IsSameGeometry || (!IsSameColor && !IsRecolored))
+    {
+        Cache.LocalTree = BuildBSPTree(Mesh.GeneratePolygons(Mesh.VertexIndices, Identity()), Params);
+        Cache.LocalGenerated = {};
+        BSPGenerateVertices(Cache.LocalTree, Cache.LocalGenerated);
+        Cache.BuildCount++;
+    }
+    else if(IsRecolored)
+    {
+        BSPSetColor(Cache.LocalTree, Cache.LocalGenerated, Mesh.Vertices[0].Col);
+    }
+
+    // NOTE: a moved mesh keeps its topology, so the local tree is only moved into place
+    Cache.Tree = Cache.LocalTree;
+    BSPTransformTree(Cache.Tree, Mesh.Model);
+    Cache.Generated = Cache.LocalGenerated;
+    TransformVertices(Cache.Generated.Vertices, Mesh.Model);
+
+    Cache.GeometryVersion = Mesh.GeometryVersion;
+    Cache.ColorVersion = Mesh.ColorVersion;
+    Cache.Model = Mesh.Model;
+    Cache.IsValid = true;
+
+    if(Stats)
+    {
+        Stats->PolygonsIn  += Mesh.VertexIndices.size() / 3;
+        Stats->PolygonsOut += Cache.Generated.VertexIndices.size() / 3;
+    }
+
+    return true;
+}
+
+aabb
+GetPolygonsAABB(const polygon_soup& Polygons, uint32_t First, uint32_t Count)
+{
+    aabb Result;
+    Result.Min = vec3(std::numeric_limits<float>::max());
+    Result.Max = vec3(std::numeric_limits<float>::lowest());
+    for(uint32_t VertIdx = 0;
+        VertIdx < 3;
+        ++VertIdx)
+    {
+        for(uint32_t Idx = First;
+            Idx < First + Count;
+            ++Idx)
+        {
+            Result.Min.x = std::min(Result.Min.x, Polygons.X[VertIdx][Idx]);
+            Result.Min.y = std::min(Result.Min.y, Polygons.Y[VertIdx][Idx]);
+            Result.Min.z = std::min(Result.Min.z, Polygons.Z[VertIdx][Idx]);
+            Result.Max.x = std::max(Result.Max.x, Polygons.X[VertIdx][Idx]);
+            Result.Max.y = std::max(Result.Max.y, Polygons.Y[VertIdx][Idx]);
+            Result.Max.z = std::max(Result.Max.z, Polygons.Z[VertIdx][Idx]);
+        }
+    }
+
+    return Result;
+}
+
+aabb
+AABBUnion(aabb A, aabb B)
+{
+    aabb Result;
+    Result.Min = vec3(std::min(A.Min.x, B.Min.x), std::min(A.Min.y, B.Min.y), std::min(A.Min.z, B.Min.z));
+    Result.Max = vec3(std::max(A.Max.x, B.Max.x), std::max(A.Max.y, B.Max.y), std::max(A.Max.z, B.Max.z));
+    return Result;
+}
+
+bool
+AABBOverlap(const aabb& A, const aabb& B)
+{
+    return (A.Min.x <= B.Max.x) && (A.Max.x >= B.Min.x) &&
+           (A.Min.y <= B.Max.y) && (A.Max.y >= B.Min.y) &&
+           (A.Min.z <= B.Max.z) && (A.Max.z >= B.Min.z);
+}
+
+// NOTE: Bounds[NodeIdx] gets the bounds of all polygons in the subtree of NodeIdx
+aabb
+BSPComputeBounds(const bsp_tree& Tree, uint32_t NodeIdx, std::vector<aabb>& Bounds)
+{
+    const bsp_node& Node = Tree.Nodes[NodeIdx];
+    aabb Result = GetPolygonsAABB(Tree.Polygons, Node.FirstPolygon, Node.PolygonCount);
+    if(Node.Front != BSP_NULL_NODE)
+        Result = AABBUnion(Result, BSPComputeBounds(Tree, Node.Front, Bounds));
+    if(Node.Back != BSP_NULL_NODE)
+        Result = AABBUnion(Result, BSPComputeBounds(Tree, Node.Back, Bounds));
+
+    Bounds[NodeIdx] = Result;
+    return Result;
+}
+
+// NOTE: the tree is used as a solid: behind a plane without a back child is inside,
+// in front of a plane without a front child is outside. Parts of Polygons that are
+// inside (KeepInside) or outside of it are added to Result.
+// Polygons lying in a plane of the tree count as outside when the inside is kept.
+// Otherwise they count as inside when they face the same way as the plane,
+// so a face shared with the tool is removed from the stock, but a touching one is not.
+// Returns the number of pieces that were dropped
+uint32_t
+BSPClipPolygons(const bsp_tree& Tree, uint32_t NodeIdx, const polygon_soup& Polygons, bool KeepInside, polygon_soup& Result)
+{
+    if(Polygons.Size() == 0) return 0;
+
+    const bsp_node& Node = Tree.Nodes[NodeIdx];
+    vec4 SplitPlane = Node.Plane;
+    vec3 SplitNormal = SplitPlane.xyz;
+    polygon_soup Front, Back;
+
+    std::vector<uint8_t> Classes(Polygons.Size());
+    ClassifyPolygonsToPlane(Polygons, 0, Polygons.Size(), SplitPlane, Classes.data());
+    // NOTE: outside of the solid, coplanar polygons go to the side they face
+    BSPReserveSplitOutput(Classes, Front, Back, KeepInside ? &Front : nullptr);
+
+    for(uint32_t i = 0;
+        i < Polygons.Size();
+        i++)
+    {
+        switch(Classes[i])
+        {
+            case POLYGON_COPLANAR_WITH_PLANE:
+            {
+                vec4 Plane = GetPlaneFromPolygon(Polygons, i);
+                vec3 Normal = Plane.xyz;
+                bool IsSameFacing = Normal.Dot(SplitNormal) > 0;
+                if(!KeepInside && IsSameFacing) Back.Push(Polygons, i);
+                else Front.Push(Polygons, i);
+            } break;
+            case POLYGON_IN_FRONT_OF_PLANE:
+            {
+                Front.Push(Polygons, i);
+            } break;
+            case POLYGON_BEHIND_PLANE:
+            {
+                Back.Push(Polygons, i);
+            } break;
+            case POLYGON_STRADDLING_PLANE:
+            {
+                SplitPolygon(Polygons, i, SplitPlane, Front, Back);
+            } break;
+        }
+    }
+
+    uint32_t DroppedCount = 0;
+    if(Node.Front != BSP_NULL_NODE)
+        DroppedCount += BSPClipPolygons(Tree, Node.Front, Front, KeepInside, Result);
+    else if(!KeepInside)
+        Result.Append(Front);
+    else
+        DroppedCount += Front.Size();
+
+    if(Node.Back != BSP_NULL_NODE)
+        DroppedCount += BSPClipPolygons(Tree, Node.Back, Back, KeepInside, Result);
+    else if(KeepInside)
+        Result.Append(Back);
+    else
+        DroppedCount += Back.Size();
+
+    return DroppedCount;
+}
+
+// NOTE: same as BSPClipPolygons on the whole tree, but a polygon that is kept
+// all the way is added as it is and not as the pieces the tree cut it into.
+// Returns the number of polygons that were not kept whole
+uint32_t
+BSPClipPolygonsWhole(const bsp_tree& Tree, const polygon_soup& Polygons, bool KeepInside, polygon_soup& Result)
+{
+    uint32_t ClippedCount = 0;
+    polygon_soup Single, Pieces;
+    Single.Reserve(1);
+    for(uint32_t Idx = 0;
+        Idx < Polygons.Size();
+        ++Idx)
+    {
+        Single.Clear();
+        Single.Push(Polygons, Idx);
+        Pieces.Clear();
+
+        uint32_t DroppedCount = BSPClipPolygons(Tree, 0, Single, KeepInside, Pieces);
+        if(DroppedCount == 0)
+        {
+            Result.Push(Polygons, Idx);
+        }
+        else
+        {
+            Result.Append(Pieces);
+            ClippedCount++;
+        }
+    }
+
+    return ClippedCount;
+}
+
+// NOTE: writes the triangles of a node to the free slots from UsedTriangleCount on,
+// which have to be there
+static void
+BSPStockGenerateNode(bsp_stock& Stock, uint32_t NodeIdx)
+{
+    const bsp_node& Node = Stock.Tree.Nodes[NodeIdx];
+    bsp_stock_range& Range = Stock.Ranges[NodeIdx];
+    Range.FirstTriangle = Stock.UsedTriangleCount;
+    Range.TriangleCount = Node.PolygonCount;
+
+    uint32_t VertexCount = Stock.Generated.Vertices.size();
+    uint32_t VertexIndex = Range.FirstTriangle * 3;
+    for(uint32_t Idx = Node.FirstPolygon;
+        Idx < Node.FirstPolygon + Node.PolygonCount;
+        ++Idx)
+    {
+        for(uint32_t VertIdx = 0;
+            VertIdx < 3;
+            ++VertIdx)
+        {
+            const vertex_attribs& Attribs = Stock.Tree.Polygons.Attribs[Idx * 3 + VertIdx];
+            vertex NewVert;
+            NewVert.Pos  = vec4(Stock.Tree.Polygons.GetPos(Idx, VertIdx), 1);
+            NewVert.Norm = Attribs.Norm;
+            NewVert.Col  = Attribs.Col;
+
+            auto [It, IsNew] = Stock.UniqueVertices.try_emplace(NewVert, static_cast<uint32_t>(Stock.Generated.Vertices.size()));
+            if(IsNew) Stock.Generated.Vertices.push_back(NewVert);
+
+            Stock.Generated.VertexIndices[VertexIndex++] = It->second;
+        }
+    }
+    Stock.UsedTriangleCount += Node.PolygonCount;
+
+    if(CurrentStats)
+    {
+        CurrentStats->VertexLookups += Node.PolygonCount * 3;
+        CurrentStats->VertexHits += Node.PolygonCount * 3 - (Stock.Generated.Vertices.size() - VertexCount);
+    }
+}
+
+// NOTE: makes Generated again from the whole tree, in the same order as BSPGenerateVertices.
+// A quarter more free slots are left after the triangles for the nodes later cuts change
+static void
+BSPStockGenerateAll(bsp_stock& Stock)
+{
+    uint64_t GeneratedVersion = Stock.Generated.GeometryVersion + 1;
+    Stock.Generated = {};
+    Stock.UniqueVertices.clear();
+    Stock.Ranges.assign(Stock.Tree.Nodes.size(), {});
+    Stock.ChangedNodes.clear();
+
+    std::vector<uint32_t> Order = BSPGetNodesBreadthFirst(Stock.Tree);
+    uint32_t TriangleCount = 0;
+    for(uint32_t NodeIdx : Order)
+    {
+        TriangleCount += Stock.Tree.Nodes[NodeIdx].PolygonCount;
+    }
+
+    // NOTE: a free slot points at vertex 0, a mesh without triangles gets none
+    uint32_t SlotCount = TriangleCount ? TriangleCount + TriangleCount / 4 : 0;
+    Stock.Generated.VertexIndices.assign(SlotCount * 3, 0);
+    Stock.UsedTriangleCount = 0;
+    for(uint32_t NodeIdx : Order)
+    {
+        BSPStockGenerateNode(Stock, NodeIdx);
+    }
+
+    Stock.Generated.GeometryVersion = GeneratedVersion;
+    Stock.GeneratedGarbageCount = 0;
+    Stock.LayoutVersion++;
+}
+
+// NOTE: generates the triangles of the nodes whose polygons changed since the last time,
+// the rest of Generated stays as it is
+static void
+BSPStockGenerateChanged(bsp_stock& Stock)
+{
+    std::vector<uint32_t>& Changed = Stock.ChangedNodes;
+    std::sort(Changed.begin(), Changed.end());
+    Changed.erase(std::unique(Changed.begin(), Changed.end()), Changed.end());
+    Stock.Ranges.resize(Stock.Tree.Nodes.size(), {});
+
+    uint32_t NewCount = 0;
+    uint32_t GarbageCount = Stock.GeneratedGarbageCount;
+    for(uint32_t NodeIdx : Changed)
+    {
+        NewCount += Stock.Tree.Nodes[NodeIdx].PolygonCount;
+        GarbageCount += Stock.Ranges[NodeIdx].TriangleCount;
+    }
+
+    uint32_t SlotCount = Stock.Generated.VertexIndices.size() / 3;
+    if((Stock.UsedTriangleCount + NewCount > SlotCount) || (GarbageCount > (Stock.UsedTriangleCount + NewCount) / 2))
+    {
+        BSPStockGenerateAll(Stock);
+        return;
+    }
+
+    for(uint32_t NodeIdx : Changed)
+    {
+        const bsp_stock_range& Range = Stock.Ranges[NodeIdx];
+        std::fill(Stock.Generated.VertexIndices.begin() + Range.FirstTriangle * 3,
+                  Stock.Generated.VertexIndices.begin() + (Range.FirstTriangle + Range.TriangleCount) * 3, 0);
+        BSPStockGenerateNode(Stock, NodeIdx);
+    }
+
+    Stock.Generated.GeometryVersion++;
+    Stock.GeneratedGarbageCount = GarbageCount;
+    Changed.clear();
+}
+
+// NOTE: (re)builds the stock when the source mesh changed, cuts done so far are lost.
+// Returns true if it was rebuilt
+bool
+UpdateBSPStock(bsp_stock& Stock, mesh& Mesh, const bsp_build_params& Params, csg_stats* Stats)
+{
+    bool IsSameModel = memcmp(Stock.Model.V, Mesh.Model.V, sizeof(Mesh.Model.V)) == 0;
+    if(Stock.IsValid && (Stock.GeometryVersion == Mesh.GeometryVersion) &&
+       (Stock.ColorVersion == Mesh.ColorVersion) && IsSameModel) return false;
+
+    PROFILE_SCOPE(profile_tree_build);
+    csg_stats_scope StatsScope(Stats);
+
+    Stock.Tree = BuildBSPTree(Mesh.GeneratePolygons(Mesh.VertexIndices), Params);
+    Stock.Bounds.assign(Stock.Tree.Nodes.size(), {});
+    if(!Stock.Tree.Nodes.empty()) BSPComputeBounds(Stock.Tree, 0, Stock.Bounds);
+    BSPStockGenerateAll(Stock);
+
+    Stock.GarbageCount = 0;
+    Stock.CutCount = 0;
+    Stock.GeometryVersion = Mesh.GeometryVersion;
+    Stock.ColorVersion = Mesh.ColorVersion;
+    Stock.Model = Mesh.Model;
+    Stock.IsValid = true;
+
+    if(Stats)
+    {
+        Stats->PolygonsIn  += Mesh.VertexIndices.size() / 3;
+        Stats->PolygonsOut += Stock.UsedTriangleCount;
+    }
+
+    return true;
+}
+
+void
+BSPStockSetNodePolygons(bsp_stock& Stock, uint32_t NodeIdx, const polygon_soup& Polygons)
+{
+    bsp_node& Node = Stock.Tree.Nodes[NodeIdx];
+    Stock.GarbageCount += Node.PolygonCount;
+    Node.FirstPolygon = Stock.Tree.Polygons.Size();
+    Node.PolygonCount = Polygons.Size();
+    Stock.Tree.Polygons.Append(Polygons);
+    Stock.ChangedNodes.push_back(NodeIdx);
+}
+
+// NOTE: removes the parts of stock polygons that are inside of the tool.
+// Only polygons which bounds overlap the tool are clipped, subtrees that
+// are away from the tool are skipped. Returns the number of polygons that were cut
+uint32_t
+BSPStockClipNode(bsp_stock& Stock, uint32_t NodeIdx, const bsp_tree& Tool, const aabb& ToolBounds)
+{
+    if(!AABBOverlap(Stock.Bounds[NodeIdx], ToolBounds)) return 0;
+
+    const bsp_node& Node = Stock.Tree.Nodes[NodeIdx];
+    polygon_soup Kept, Touched;
+    for(uint32_t Idx = Node.FirstPolygon;
+        Idx < Node.FirstPolygon + Node.PolygonCount;
+        ++Idx)
+    {
+        if(AABBOverlap(GetPolygonsAABB(Stock.Tree.Polygons, Idx, 1), ToolBounds))
+            Touched.Push(Stock.Tree.Polygons, Idx);
+        else
+            Kept.Push(Stock.Tree.Polygons, Idx);
+    }
+
+    uint32_t ClippedCount = 0;
+    if(Touched.Size()) ClippedCount = BSPClipPolygonsWhole(Tool, Touched, false, Kept);
+    if(ClippedCount) BSPStockSetNodePolygons(Stock, NodeIdx, Kept);
+
+    uint32_t FrontIdx = Stock.Tree.Nodes[NodeIdx].Front;
+    uint32_t BackIdx  = Stock.Tree.Nodes[NodeIdx].Back;
+    if(FrontIdx != BSP_NULL_NODE) ClippedCount += BSPStockClipNode(Stock, FrontIdx, Tool, ToolBounds);
+    if(BackIdx  != BSP_NULL_NODE) ClippedCount += BSPStockClipNode(Stock, BackIdx, Tool, ToolBounds);
+
+    return ClippedCount;
+}
+
+// NOTE: splits a closed convex polytope into the parts in front of and behind the plane.
+// Both parts are closed again with a cap in the plane, so they can be split further.
+// A part that is empty gets no polygons
+void
+SplitConvexPolytope(const polygon_soup& Polytope, vec4 Plane, polygon_soup& Front, polygon_soup& Back)
+{
+    vec3 Normal = Plane.xyz;
+
+    std::vector<uint8_t> Classes(Polytope.Size());
+    ClassifyPolygonsToPlane(Polytope, 0, Polytope.Size(), Plane, Classes.data());
+
+    uint32_t ClassCounts[4] = {};
+    for(uint8_t Class : Classes) ClassCounts[Class]++;
+    bool HasFront = ClassCounts[POLYGON_IN_FRONT_OF_PLANE] || ClassCounts[POLYGON_STRADDLING_PLANE];
+    bool HasBack  = ClassCounts[POLYGON_BEHIND_PLANE] || ClassCounts[POLYGON_STRADDLING_PLANE];
+    if(!HasFront || !HasBack)
+    {
+        // NOTE: a face lying in the plane faces away from the rest of the polytope
+        if(!HasFront && !HasBack)
+        {
+            vec4 FacePlane = GetPlaneFromPolygon(Polytope, 0);
+            vec3 FaceNormal = FacePlane.xyz;
+            HasBack = FaceNormal.Dot(Normal) > 0;
+        }
+        (HasBack ? Back : Front).Append(Polytope);
+        return;
+    }
+
+    BSPReserveSplitOutput(Classes, Front, Back, &Front);
+    for(uint32_t i = 0;
+        i < Polytope.Size();
+        i++)
+    {
+        switch(Classes[i])
+        {
+            case POLYGON_COPLANAR_WITH_PLANE:
+            case POLYGON_IN_FRONT_OF_PLANE:
+            {
+                Front.Push(Polytope, i);
+            } break;
+            case POLYGON_BEHIND_PLANE:
+            {
+                Back.Push(Polytope, i);
+            } break;
+            case POLYGON_STRADDLING_PLANE:
+            {
+                SplitPolygon(Polytope, i, Plane, Front, Back);
+            } break;
+        }
+    }
+
+    // NOTE: the section is convex, so its points sorted by angle around
+    // their center give the outline of the cap
+    std::vector<vec3> Section;
+    for(uint32_t Idx = 0;
+        Idx < Back.Size();
+        ++Idx)
+    {
+        for(uint32_t VertIdx = 0;
+            VertIdx < 3;
+            ++VertIdx)
+        {
+            vec3 P = Back.GetPos(Idx, VertIdx);
+            if(ClassifyPointToPlane(P, Plane) == POINT_ON_PLANE) Section.push_back(P);
+        }
+    }
+    if(Section.size() < 3) return;
+
+    vec3 Center = vec3(0);
+    for(vec3 P : Section) Center = Center + P;
+    Center = Center * (1.0f / Section.size());
+
+    vec3 U = (std::abs(Normal.x) < 0.9f) ? vec3(1, 0, 0) : vec3(0, 1, 0);
+    U = Cross(U, Normal).Normalize();
+    vec3 V = Cross(Normal, U);
+
+    std::vector<std::pair<float, vec3>> Outline;
+    Outline.reserve(Section.size());
+    for(vec3 P : Section)
+    {
+        vec3 D = P - Center;
+        Outline.push_back({std::atan2(D.Dot(V), D.Dot(U)), P});
+    }
+    std::sort(Outline.begin(), Outline.end(),
+              [](const std::pair<float, vec3>& A, const std::pair<float, vec3>& B) { return A.first < B.first; });
+
+    std::vector<vec3> Cap;
+    for(auto& Point : Outline)
+    {
+        if(Cap.size() && ((Point.second - Cap.back()).Length() <= PLANE_THICKNESS)) continue;
+        Cap.push_back(Point.second);
+    }
+    while((Cap.size() > 1) && ((Cap.front() - Cap.back()).Length() <= PLANE_THICKNESS)) Cap.pop_back();
+
+    // NOTE: the outline goes counter clockwise around the plane normal,
+    // which is the outside of the back part
+    vertex_attribs Attribs = {};
+    for(uint32_t Idx = 1;
+        Idx + 1 < Cap.size();
+        ++Idx)
+    {
+        Back.Push(Cap[0], Cap[Idx], Cap[Idx + 1], Attribs, Attribs, Attribs);
+        Front.Push(Cap[0], Cap[Idx + 1], Cap[Idx], Attribs, Attribs, Attribs);
+    }
+}
+
+// NOTE: inserts the cut walls into the stock tree without copying it.
+// Walls are kept whole and stored at the first node they are not all on one side of.
+// Cut are the walls split by the tree, they only give the planes of the new subtrees
+// where they reach a solid leaf, the subtrees have no polygons.
+// Tool is the closed tool polytope split along with them, it only goes to the
+// sides it reaches. A solid leaf which it reaches without any wall is all inside
+// of the tool and is made empty.
+// The stock gets deeper with every cut, so the depth limit of BuildBSPNode only
+// applies to the new subtree, a node past it would not be a solid any more
+void
+BSPStockInsertNode(bsp_stock& Stock, uint32_t NodeIdx, const polygon_soup& Walls, const polygon_soup& Cut,
+                   const polygon_soup& Tool, const bsp_build_params& Params)
+{
+    if(Walls.Size())
+        Stock.Bounds[NodeIdx] = AABBUnion(Stock.Bounds[NodeIdx], GetPolygonsAABB(Walls, 0, Walls.Size()));
+
+    vec4 SplitPlane = Stock.Tree.Nodes[NodeIdx].Plane;
+    polygon_soup NodeWalls, FrontWalls, BackWalls;
+    polygon_soup FrontCut, BackCut;
+    polygon_soup FrontTool, BackTool;
+
+    std::vector<uint8_t> Classes(Walls.Size());
+    ClassifyPolygonsToPlane(Walls, 0, Walls.Size(), SplitPlane, Classes.data());
+    for(uint32_t i = 0;
+        i < Walls.Size();
+        i++)
+    {
+        if(Classes[i] == POLYGON_IN_FRONT_OF_PLANE) FrontWalls.Push(Walls, i);
+        else if(Classes[i] == POLYGON_BEHIND_PLANE) BackWalls.Push(Walls, i);
+        else NodeWalls.Push(Walls, i);
+    }
+
+    // NOTE: cut pieces in the plane of the node are already split by it
+    Classes.resize(Cut.Size());
+    ClassifyPolygonsToPlane(Cut, 0, Cut.Size(), SplitPlane, Classes.data());
+    BSPReserveSplitOutput(Classes, FrontCut, BackCut);
+    for(uint32_t i = 0;
+        i < Cut.Size();
+        i++)
+    {
+        switch(Classes[i])
+        {
+            case POLYGON_IN_FRONT_OF_PLANE:
+            {
+                FrontCut.Push(Cut, i);
+            } break;
+            case POLYGON_BEHIND_PLANE:
+            {
+                BackCut.Push(Cut, i);
+            } break;
+            case POLYGON_STRADDLING_PLANE:
+            {
+                SplitPolygon(Cut, i, SplitPlane, FrontCut, BackCut);
+            } break;
+        }
+    }
+
+    SplitConvexPolytope(Tool, SplitPlane, FrontTool, BackTool);
+
+    polygon_soup* SideWalls[2] = {&FrontWalls, &BackWalls};
+    polygon_soup* SideCuts[2] = {&FrontCut, &BackCut};
+    polygon_soup* SideTools[2] = {&FrontTool, &BackTool};
+    for(uint32_t SideIdx = 0;
+        SideIdx < 2;
+        ++SideIdx)
+    {
+        polygon_soup& Side = *SideWalls[SideIdx];
+        const polygon_soup& SideCut = *SideCuts[SideIdx];
+        const polygon_soup& SideTool = *SideTools[SideIdx];
+        if((Side.Size() == 0) && (SideCut.Size() == 0) && (SideTool.Size() == 0)) continue;
+
+        uint32_t ChildIdx = (SideIdx == 0) ? Stock.Tree.Nodes[NodeIdx].Front : Stock.Tree.Nodes[NodeIdx].Back;
+        if(ChildIdx != BSP_NULL_NODE)
+        {
+            BSPStockInsertNode(Stock, ChildIdx, Side, SideCut, SideTool, Params);
+            continue;
+        }
+
+        // NOTE: walls that reach a leaf stay at this node
+        NodeWalls.Append(Side);
+
+        // NOTE: nothing to remove from the empty space in front
+        if(SideIdx == 0) continue;
+
+        if(SideCut.Size())
+        {
+            bsp_tree SubTree;
+            BuildBSPNode(SideCut, SubTree, Params, 0);
+            SubTree.Polygons.Clear();
+            for(bsp_node& Node : SubTree.Nodes)
+            {
+                Node.FirstPolygon = 0;
+                Node.PolygonCount = 0;
+            }
+            ChildIdx = BSPAppendTree(Stock.Tree, SubTree);
+        }
+        else if(SideTool.Size())
+        {
+            // NOTE: all of the leaf is in front of the flipped plane
+            ChildIdx = BSPPushNode(Stock.Tree, vec4(-SplitPlane.x, -SplitPlane.y, -SplitPlane.z, -SplitPlane.w));
+        }
+        else
+        {
+            continue;
+        }
+        Stock.Bounds.resize(Stock.Tree.Nodes.size());
+        BSPComputeBounds(Stock.Tree, ChildIdx, Stock.Bounds);
+
+        Stock.Tree.Nodes[NodeIdx].Back = ChildIdx;
+    }
+
+    if(NodeWalls.Size())
+    {
+        const bsp_node& Node = Stock.Tree.Nodes[NodeIdx];
+        polygon_soup NodePolygons;
+        NodePolygons.Append(Stock.Tree.Polygons, Node.FirstPolygon, Node.PolygonCount);
+        NodePolygons.Append(NodeWalls);
+        BSPStockSetNodePolygons(Stock, NodeIdx, NodePolygons);
+    }
+}
+
+// NOTE: moves the polygons of every node next to each other again
+void
+BSPStockCompact(bsp_stock& Stock)
+{
+    polygon_soup Polygons;
+    Polygons.Reserve(Stock.Tree.Polygons.Size() - Stock.GarbageCount);
+    for(bsp_node& Node : Stock.Tree.Nodes)
+    {
+        uint32_t FirstPolygon = Polygons.Size();
+        Polygons.Append(Stock.Tree.Polygons, Node.FirstPolygon, Node.PolygonCount);
+        Node.FirstPolygon = FirstPolygon;
+    }
+
+    Stock.Tree.Polygons = std::move(Polygons);
+    Stock.GarbageCount = 0;
+}
+
+// NOTE: the tree of a closed convex solid has every polygon behind every plane,
+// so no node has a front child
+static bool
+BSPIsConvexTree(const bsp_tree& Tree)
+{
+    for(const bsp_node& Node : Tree.Nodes)
+    {
+        if(Node.Front != BSP_NULL_NODE) return false;
+    }
+    return true;
+}
+
+// NOTE: subtracts the tool from the stock in place. Only stock nodes close to the
+// tool are visited and only the tree paths of the tool polygons are walked,
+// so the cost follows the size of the cut and not the size of the stock.
+// Only the triangles of the nodes the cut changed are generated again.
+// The in place cut splits the tool as a convex polytope to empty the solid leaves
+// it covers (see BSPStockInsertNode), so the tool has to be closed and convex.
+// A tool whose tree is not convex takes the path of MeshSubtract instead, the stock
+// is built again from the kept polygons and the walls, which is linear in the stock.
+// Returns false if the tool did not remove anything
+bool
+BSPStockSubtract(bsp_stock& Stock, const bsp_tree& Tool, const bsp_build_params& Params, csg_stats* Stats)
+{
+    if(Stock.Tree.Nodes.empty() || Tool.Nodes.empty()) return false;
+
+    PROFILE_SCOPE(profile_subtract);
+    csg_stats_scope StatsScope(Stats);
+    uint32_t PolygonsIn = Stock.Tree.Polygons.Size() - Stock.GarbageCount + Tool.Polygons.Size();
+    Stock.ChangedNodes.clear();
+
+    aabb ToolBounds = GetPolygonsAABB(Tool.Polygons, 0, Tool.Polygons.Size());
+    if(!AABBOverlap(Stock.Bounds[0], ToolBounds)) return false;
+
+    // NOTE: tool polygons inside of the stock become the walls of the cut, facing
+    // into the removed part. This has to use the tree from before the cut
+    polygon_soup Inside;
+    BSPClipPolygonsWhole(Stock.Tree, Tool.Polygons, true, Inside);
+
+    polygon_soup Walls;
+    Walls.Reserve(Inside.Size());
+    for(uint32_t Idx = 0;
+        Idx < Inside.Size();
+        ++Idx)
+    {
+        vertex_attribs Attribs[3];
+        for(uint32_t VertIdx = 0;
+            VertIdx < 3;
+            ++VertIdx)
+        {
+            Attribs[VertIdx] = Inside.Attribs[Idx * 3 + VertIdx];
+            Attribs[VertIdx].Norm = vec3(-Attribs[VertIdx].Norm.x, -Attribs[VertIdx].Norm.y, -Attribs[VertIdx].Norm.z);
+        }
+        Walls.Push(Inside.GetPos(Idx, 2), Inside.GetPos(Idx, 1), Inside.GetPos(Idx, 0), Attribs[2], Attribs[1], Attribs[0]);
+    }
+
+    if(BSPIsConvexTree(Tool))
+    {
+        uint32_t ClippedCount = BSPStockClipNode(Stock, 0, Tool, ToolBounds);
+        if((Walls.Size() == 0) && (ClippedCount == 0)) return false;
+
+        BSPStockInsertNode(Stock, 0, Walls, Walls, Tool.Polygons, Params);
+
+        if(Stock.GarbageCount > Stock.Tree.Polygons.Size() / 2) BSPStockCompact(Stock);
+
+        BSPStockGenerateChanged(Stock);
+    }
+    else
+    {
+        polygon_soup Polygons;
+        Polygons.Reserve(Stock.Tree.Polygons.Size() - Stock.GarbageCount);
+        for(const bsp_node& Node : Stock.Tree.Nodes)
+        {
+            Polygons.Append(Stock.Tree.Polygons, Node.FirstPolygon, Node.PolygonCount);
+        }
+
+        polygon_soup Kept;
+        uint32_t ClippedCount = BSPClipPolygonsWhole(Tool, Polygons, false, Kept);
+        if((Walls.Size() == 0) && (ClippedCount == 0)) return false;
+
+        Kept.Append(Walls);
+        Stock.Tree = BuildBSPTree(Kept, Params);
+        Stock.Bounds.assign(Stock.Tree.Nodes.size(), {});
+        if(!Stock.Tree.Nodes.empty()) BSPComputeBounds(Stock.Tree, 0, Stock.Bounds);
+        Stock.GarbageCount = 0;
+
+        BSPStockGenerateAll(Stock);
+    }
+    Stock.CutCount++;
+
+    if(Stats)
+    {
+        Stats->PolygonsIn  += PolygonsIn;
+        Stats->PolygonsOut += Stock.Tree.Polygons.Size() - Stock.GarbageCount;
+    }
+
+    return true;
+}
+
+// NOTE: true if To differs from From only by the translation
+bool
+IsTranslationOf(const mat4& From, const mat4& To, vec3& Translation)
+{
+    if((From.E11 != To.E11) || (From.E12 != To.E12) || (From.E13 != To.E13) ||
+       (From.E21 != To.E21) || (From.E22 != To.E22) || (From.E23 != To.E23) ||
+       (From.E31 != To.E31) || (From.E32 != To.E32) || (From.E33 != To.E33))
+        return false;
+
+    Translation = vec3(To.E14 - From.E14, To.E24 - From.E24, To.E34 - From.E34);
+    return true;
+}
+
+// NOTE: builds the bvh of Generated when it was made again from the whole tree,
+// after a cut that only changed some nodes the bvh is refit
+void
+UpdateBSPStockBVH(bsp_stock& Stock)
+{
+    if(Stock.BVH.IsValid && (Stock.BVH.GeometryVersion == Stock.Generated.GeometryVersion) &&
+       (Stock.BVHLayoutVersion == Stock.LayoutVersion)) return;
+
+    if(Stock.BVHLayoutVersion == Stock.LayoutVersion) RefitBVHTriangles(Stock.BVH, Stock.Generated, Identity());
+    else BuildBVH(Stock.BVH, Stock.Generated, Identity());
+    Stock.BVHLayoutVersion = Stock.LayoutVersion;
+}
+
+// NOTE: calls Test with the corners of the triangles in Bounds until it returns true.
+// Only nodes which subtree bounds overlap Bounds are visited, and only the triangles of
+// their ranges, vertices that just old triangles used are left out. Corners shared by
+// triangles are given more than once
+template<typename test>
+static bool
+BSPStockAnyVertex(const bsp_stock& Stock, const aabb& Bounds, test Test)
+{
+    if(Stock.Tree.Nodes.empty()) return false;
+
+    std::vector<uint32_t> Stack;
+    Stack.push_back(0);
+    while(!Stack.empty())
+    {
+        uint32_t NodeIdx = Stack.back();
+        Stack.pop_back();
+        if(!AABBOverlap(Stock.Bounds[NodeIdx], Bounds)) continue;
+
+        const bsp_stock_range& Range = Stock.Ranges[NodeIdx];
+        for(uint32_t Idx = Range.FirstTriangle * 3;
+            Idx < (Range.FirstTriangle + Range.TriangleCount) * 3;
+            ++Idx)
+        {
+            const v4<float>& Pos = Stock.Generated.Vertices[Stock.Generated.VertexIndices[Idx]].Pos;
+            vec3 Point = vec3(Pos.x, Pos.y, Pos.z);
+            if((Point.x < Bounds.Min.x) || (Point.y < Bounds.Min.y) || (Point.z < Bounds.Min.z) ||
+               (Point.x > Bounds.Max.x) || (Point.y > Bounds.Max.y) || (Point.z > Bounds.Max.z))
+                continue;
+            if(Test(Point)) return true;
+        }
+
+        const bsp_node& Node = Stock.Tree.Nodes[NodeIdx];
+        if(Node.Front != BSP_NULL_NODE) Stack.push_back(Node.Front);
+        if(Node.Back  != BSP_NULL_NODE) Stack.push_back(Node.Back);
+    }
+    return false;
+}
+
+// NOTE: BSPIsAnyVertexInside for the vertices of the stock that are in use
+bool
+BSPStockIsAnyVertexInside(const bsp_tree& Tree, const bsp_stock& Stock, const aabb& Bounds)
+{
+    return BSPStockAnyVertex(Stock, Bounds, [&](vec3 Point) { return BSPIsPointInside(Tree, Point); });
+}
+
+// NOTE: true if the solid a convex tool sweeps (see SweepConvexShape) crosses the stock,
+// is all inside of it, or has a piece of the stock all inside of it. The stock bvh has to be
+// up to date (see UpdateBSPStockBVH).
+// When no triangles cross, the surfaces are apart and vertices decide which one is inside
+bool
+BSPStockSweepIntersect(const bsp_stock& Stock, mesh& Swept, bvh& SweptBVH)
+{
+    aabb SweptBounds = Swept.GetAABB();
+    if(!AABBOverlap(Stock.Bounds[0], SweptBounds)) return false;
+
+    UpdateBVH(SweptBVH, Swept, Identity());
+    if(BVHIntersect(Stock.BVH, SweptBVH)) return true;
+    if(BSPIsAnyVertexInside(Stock.Tree, Swept, Stock.Bounds[0])) return true;
+
+    return BSPStockAnyVertex(Stock, SweptBounds, [&](vec3 Point) { return IsPointInsideConvex(Swept, Point); });
+}
@@ -0,0 +1,235 @@
+#ifndef CSG_H
+#define CSG_H
+
+#include "mat_h.hpp"
+#include "mesh.h"
+#include "taskpool.h"
+#include "classify.h"
+#include "bvh.h"
+#include "convex.h"
+#include "profiler.h"
+
+#include <vector>
+
+enum bsp_bool
+{
+    bsp_union,
+    bsp_not,
+};
+
+const uint32_t BSP_MAX_DEPTH = 25;
+
+enum bsp_split_strategy
+{
+    bsp_split_all,          // every polygon plane is a candidate, O(n^2) per node
+    bsp_split_random,       // CandidateCount random polygons
+    bsp_split_stratified,   // one random polygon from each of CandidateCount equal ranges
+    bsp_split_axis_aligned, // polygons with axis aligned planes closest to the median, stratified otherwise
+};
+
+struct bsp_build_params
+{
+    bsp_split_strategy Strategy = bsp_split_all;
+    uint32_t CandidateCount = 32;
+    uint32_t Seed = 0;
+    // NOTE: stop at the first candidate that does not straddle any polygon
+    // and still has polygons on both sides
+    bool StopAtZeroStraddle = true;
+
+    // NOTE: if set, subtrees with at least ParallelCutoff polygons on both sides
+    // and candidate scoring are done as tasks. The tree is the same as the serial one
+    task_pool* Pool = nullptr;
+    uint32_t ParallelCutoff = 256;
+
+    // NOTE: a node this deep becomes a leaf that keeps its polygons without a plane,
+    // which drops the planes below it from the solid. The tree of a convex solid is a
+    // chain with one node per plane, so it needs a depth of its plane count
+    uint32_t MaxDepth = BSP_MAX_DEPTH;
+};
+
+struct bsp_tree_quality
+{
+    uint32_t NodeCount = 0;
+    uint32_t LeafCount = 0;
+    uint32_t MaxDepth = 0;
+    uint32_t PolygonCount = 0;
+    float AverageDepth = 0; // NOTE: weighted by polygon count
+};
+
+// NOTE: counters of one build or subtract call, filled if the call is given a csg_stats.
+// Counts are added to, so one csg_stats can sum several calls. NodeCount and
+// MaxDepth are about the trees built by the call, for a stock cut these are only
+// the new subtrees and their depth below the node they were inserted at.
+// DepthCapHits is the number of leaves made at MaxDepth of the build, their polygons
+// are kept in the leaf without a plane. The vertex counters are the lookups
+// into UniqueVertices when vertices are generated, a hit is a reused vertex.
+// A stock cut that removes nothing only adds its splits
+struct csg_stats
+{
+    uint32_t PolygonsIn = 0;
+    uint32_t PolygonsOut = 0;
+    uint32_t SplitCalls = 0;
+    uint32_t SplitFragments = 0;
+    uint32_t NodeCount = 0;
+    uint32_t MaxDepth = 0;
+    uint32_t DepthCapHits = 0;
+    uint64_t VertexLookups = 0;
+    uint64_t VertexHits = 0;
+
+    float GetVertexHitRatio() const
+    {
+        return VertexLookups ? (float)VertexHits / (float)VertexLookups : 0.0f;
+    }
+};
+
+void AddCSGStats(csg_stats& Stats, const csg_stats& Other);
+
+const uint32_t BSP_NULL_NODE = 0xFFFFFFFF;
+
+struct bsp_node
+{
+    vec4 Plane;
+    uint32_t FirstPolygon;
+    uint32_t PolygonCount;
+    uint32_t Front;
+    uint32_t Back;
+};
+
+// NOTE: all nodes are in one array with the root first, stored depth first
+// (node, front subtree, back subtree). Polygons of a node are the range
+// [FirstPolygon, FirstPolygon + PolygonCount) of the Polygons array
+struct bsp_tree
+{
+    std::vector<bsp_node> Nodes;
+    polygon_soup Polygons;
+};
+
+// NOTE: tree built from a mesh and the vertices generated from it.
+// The tree is built once in mesh space (LocalTree) and is only rebuilt when
+// the geometry version changes. When just the model matrix changes,
+// Tree and Generated are the local ones moved by the new matrix.
+// A mesh of one color that gets a new one is recolored in place
+struct bsp_cache
+{
+    bsp_tree LocalTree;
+    mesh LocalGenerated;
+
+    bsp_tree Tree;
+    mesh Generated;
+
+    uint64_t GeometryVersion = 0;
+    uint64_t ColorVersion = 0;
+    mat4 Model = {};
+    bool IsValid = false;
+
+    // NOTE: number of BuildBSPTree calls, a mesh that only moves keeps it the same
+    uint32_t BuildCount = 0;
+};
+
+// NOTE: triangles [FirstTriangle, FirstTriangle + TriangleCount) of Generated are the polygons of a node
+struct bsp_stock_range
+{
+    uint32_t FirstTriangle;
+    uint32_t TriangleCount;
+};
+
+// NOTE: stock mesh that cuts are subtracted from in place. Tree is the solid of
+// the remaining material and Bounds[NodeIdx] bounds the polygons of the subtree
+// of a node, so a cut only visits the nodes close to the tool.
+// Only a closed convex tool is cut in place (see BSPStockSubtract).
+// When polygons of a node change, its range is moved to the end of the polygon
+// array and the old range is left as garbage until the array is compacted.
+// Generated is kept the same way, Ranges[NodeIdx] are the triangles made from a node.
+// A node whose polygons changed gets new triangles after UsedTriangleCount and its old
+// ones become free slots (see bvh). Vertices are shared by all nodes through
+// UniqueVertices, the ones only old triangles used stay until Generated is made again.
+// That happens when no free slots are left or half of the used ones are garbage,
+// then LayoutVersion changes and BVH is built, otherwise BVH is only refit.
+// A new color of the source mesh also rebuilds the stock, faces of the cuts
+// keep the color of the tool and can not be told apart from the rest
+struct bsp_stock
+{
+    bsp_tree Tree;
+    std::vector<aabb> Bounds;
+    mesh Generated;
+    std::vector<bsp_stock_range> Ranges;
+    std::unordered_map<vertex, uint32_t> UniqueVertices;
+    std::vector<uint32_t> ChangedNodes;
+    bvh BVH;
+
+    uint32_t GarbageCount = 0;
+    uint32_t GeneratedGarbageCount = 0;
+    uint32_t UsedTriangleCount = 0;
+    uint32_t CutCount = 0;
+
+    uint64_t LayoutVersion = 0;
+    uint64_t BVHLayoutVersion = 0;
+
+    uint64_t GeometryVersion = 0;
+    uint64_t ColorVersion = 0;
+    mat4 Model = {};
+    bool IsValid = false;
+};
+
+// NOTE: headless CSG core, nothing in here needs Qt or an OpenGL context.
+// Solids are BSP trees, the back side of a node plane is inside of the solid
+
+vec4 GetPlaneFromPolygon(const polygon_soup& Polygons, uint32_t Idx);
+vec4 TransformPlane(vec4 Plane, mat4 Transform);
+
+aabb GetPolygonsAABB(const polygon_soup& Polygons, uint32_t First, uint32_t Count);
+aabb AABBUnion(aabb A, aabb B);
+bool AABBOverlap(const aabb& A, const aabb& B);
+
+vec4 PickSplitingPlane(const polygon_soup& Polygons, const bsp_build_params& Params = {}, uint32_t Depth = 0);
+void SplitPolygon(const polygon_soup& Polygons, uint32_t PolyIdx, vec4 SplitPlane, polygon_soup& FrontPolygons, polygon_soup& BackPolygons);
+bsp_tree BuildBSPTree(const polygon_soup& Polygons, const bsp_build_params& Params = {}, csg_stats* Stats = nullptr);
+
+void BSPInsert(bsp_tree& Tree, const polygon_soup& Polygons);
+void BSPInsertInner(bsp_tree& Tree, const polygon_soup& Polygons);
+void BSPInsertOuter(bsp_tree& Tree, const polygon_soup& Polygons);
+bsp_tree BSPInsertCreateBack(const bsp_tree& Tree, const polygon_soup& Polygons);
+bsp_tree BSPInsertCreateFront(const bsp_tree& Tree, const polygon_soup& Polygons);
+void BSPMerge(bsp_tree& A, const bsp_tree& B);
+
+uint32_t BSPGetIndexCount(const bsp_tree& Tree);
+bsp_tree_quality BSPGetTreeQuality(const bsp_tree& Tree);
+
+void BSPTransformTree(bsp_tree& Tree, mat4 Transform);
+void TransformVertices(std::vector<vertex>& Vertices, mat4 Transform);
+void BSPGenerateVertices(const bsp_tree& Tree, mesh& Mesh, csg_stats* Stats = nullptr);
+
+// NOTE: true if a part of a polygon is inside of the solid of the tree.
+// If Contacts is given, it gets the indices of all such polygons,
+// otherwise the walk stops as soon as the first one is found
+// A solid of the tree that is all inside of the solid of the polygons is not found,
+// that needs a point of it tested against the other solid
+bool BSPCollision(const bsp_tree& Tree, const polygon_soup& Polygons, std::vector<uint32_t>* Contacts = nullptr);
+bool BSPCollision(const bsp_tree& Tree, mesh& Mesh, std::vector<uint32_t>* Contacts = nullptr);
+
+// NOTE: points on the surface are outside. Vertices of the mesh are taken as they are, without Model
+bool BSPIsPointInside(const bsp_tree& Tree, vec3 Point);
+bool BSPIsAnyVertexInside(const bsp_tree& Tree, const mesh& Mesh, const aabb& Bounds);
+
+// NOTE: keeps the parts of the polygons that are inside (KeepInside) or outside of the tree.
+// Returns the number of pieces or polygons that were dropped
+uint32_t BSPClipPolygons(const bsp_tree& Tree, uint32_t NodeIdx, const polygon_soup& Polygons, bool KeepInside, polygon_soup& Result);
+uint32_t BSPClipPolygonsWhole(const bsp_tree& Tree, const polygon_soup& Polygons, bool KeepInside, polygon_soup& Result);
+
+mesh BSPSubtract(const bsp_tree& ATree, const bsp_tree& BTree, const polygon_soup& APolygons, const polygon_soup& BPolygons,
+                 csg_stats* Stats = nullptr);
+mesh MeshSubtract(mesh& A, mesh& B, const bsp_build_params& Params = {}, csg_stats* Stats = nullptr);
+
+bool UpdateBSPCache(bsp_cache& Cache, mesh& Mesh, const bsp_build_params& Params = {}, csg_stats* Stats = nullptr);
+bool UpdateBSPStock(bsp_stock& Stock, mesh& Mesh, const bsp_build_params& Params = {}, csg_stats* Stats = nullptr);
+
+// NOTE: Tool is the tree of a closed solid. Only a convex one is cut in place, for any
+// other the whole stock is built again
+bool BSPStockSubtract(bsp_stock& Stock, const bsp_tree& Tool, const bsp_build_params& Params = {}, csg_stats* Stats = nullptr);
+void UpdateBSPStockBVH(bsp_stock& Stock);
+bool BSPStockIsAnyVertexInside(const bsp_tree& Tree, const bsp_stock& Stock, const aabb& Bounds);
+
+bool IsTranslationOf(const mat4& From, const mat4& To, vec3& Translation);
+bool BSPStockSweepIntersect(const bsp_stock& Stock, mesh& Swept, bvh& SweptBVH);
+
+#endif // CSG_H
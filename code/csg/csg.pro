@@ -0,0 +1,31 @@
+# NOTE: headless CSG core, builds without Qt or OpenGL so it can be linked
+# into batch jobs, benchmarks and tools that have no GL context
+
+TEMPLATE = lib
+TARGET = csg
+
+CONFIG += staticlib c++20
+CONFIG -= qt
+
+SOURCES += \
+    bvh.cpp \
+    classify.cpp \
+    convex.cpp \
+    csg.cpp \
+    mappedfile.cpp \
+    mesh.cpp \
+    profiler.cpp \
+    taskpool.cpp
+
+HEADERS += \
+    bvh.h \
+    classify.h \
+    convex.h \
+    csg.h \
+    mappedfile.h \
+    mat_h.hpp \
+    mesh.h \
+    profiler.h \
+    taskpool.h
+
+CONFIG += create_prl
@@ -0,0 +1,105 @@
+#include "mappedfile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+bool
+MapFile(mapped_file& File, const char* Path)
+{
+    UnmapFile(File);
+
+    HANDLE FileHandle = CreateFileA(Path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                    FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if(FileHandle == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER Size;
+    if(!GetFileSizeEx(FileHandle, &Size))
+    {
+        CloseHandle(FileHandle);
+        return false;
+    }
+
+    File.FileHandle = FileHandle;
+    if(Size.QuadPart == 0) return true;
+
+    HANDLE MappingHandle = CreateFileMappingA(FileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if(!MappingHandle)
+    {
+        UnmapFile(File);
+        return false;
+    }
+    File.MappingHandle = MappingHandle;
+
+    File.Data = (const char*)MapViewOfFile(MappingHandle, FILE_MAP_READ, 0, 0, 0);
+    if(!File.Data)
+    {
+        UnmapFile(File);
+        return false;
+    }
+    File.Size = (size_t)Size.QuadPart;
+
+    return true;
+}
+
+void
+UnmapFile(mapped_file& File)
+{
+    if(File.Data) UnmapViewOfFile(File.Data);
+    if(File.MappingHandle) CloseHandle((HANDLE)File.MappingHandle);
+    if(File.FileHandle) CloseHandle((HANDLE)File.FileHandle);
+    File = {};
+}
+
+#else
+
+bool
+MapFile(mapped_file& File, const char* Path)
+{
+    UnmapFile(File);
+
+    int FileDescriptor = open(Path, O_RDONLY);
+    if(FileDescriptor < 0) return false;
+
+    struct stat Stat;
+    if(fstat(FileDescriptor, &Stat) != 0)
+    {
+        close(FileDescriptor);
+        return false;
+    }
+
+    File.FileDescriptor = FileDescriptor;
+    if(Stat.st_size == 0) return true;
+
+    void* Data = mmap(nullptr, (size_t)Stat.st_size, PROT_READ, MAP_PRIVATE, FileDescriptor, 0);
+    if(Data == MAP_FAILED)
+    {
+        UnmapFile(File);
+        return false;
+    }
+    madvise(Data, (size_t)Stat.st_size, MADV_SEQUENTIAL);
+
+    File.Data = (const char*)Data;
+    File.Size = (size_t)Stat.st_size;
+
+    return true;
+}
+
+void
+UnmapFile(mapped_file& File)
+{
+    if(File.Data) munmap((void*)File.Data, File.Size);
+    if(File.FileDescriptor >= 0) close(File.FileDescriptor);
+    File = {};
+}
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+
+// NOTE: read only view of a whole file, the pages are only read when they are touched.
+// A file that could not be opened or mapped gives false, an empty one maps to
+// Data == nullptr and Size == 0
+struct mapped_file
+{
+    const char* Data = nullptr;
+    size_t Size = 0;
+
+#ifdef _WIN32
+    void* FileHandle = nullptr;
+    void* MappingHandle = nullptr;
+#else
+    int FileDescriptor = -1;
+#endif
+};
+
+bool MapFile(mapped_file& File, const char* Path);
+void UnmapFile(mapped_file& File);
+
+#endif // MAPPEDFILE_H
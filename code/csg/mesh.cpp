@@ -0,0 +1,996 @@
+#include "mesh.h"
+#include "mappedfile.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <functional>
+
+void mesh::
+UpdateColor(const vec3 NewCol)
+{
+    bool WasChanged = false;
+    for(vertex& Vertex : Vertices)
+    {
+        if(!(Vertex.Col == NewCol))
+        {
+            Vertex.Col = NewCol;
+            WasChanged = true;
+        }
+    }
+
+    if(WasChanged) ColorVersion++;
+}
+
+mesh::mesh(vec3 NewScale, vec3 NewTranslate, vec3 NewRotate)
+{
+    mat4 Result = Identity();
+    mat4 Trans = Translate(NewTranslate);
+    mat4 Scal  = Scale(NewScale);
+    mat4 RotX  = RotateX(NewRotate.x);
+    mat4 RotY  = RotateY(NewRotate.y);
+    mat4 RotZ  = RotateZ(NewRotate.z);
+    Result = Result * Scal;
+    Result = Result * RotX;
+    Result = Result * RotY;
+    Result = Result * RotZ;
+    Result = Result * Trans;
+    Model = Result;
+}
+
+void mesh::SetNewTransform(vec3 NewScale, vec3 NewTranslate, vec3 NewRotate)
+{
+    mat4 Result = Identity();
+    mat4 Trans = Translate(NewTranslate);
+    mat4 Scal  = Scale(NewScale);
+    mat4 RotX  = RotateX(NewRotate.x);
+    mat4 RotY  = RotateY(NewRotate.y);
+    mat4 RotZ  = RotateZ(NewRotate.z);
+    Result = Result * Scal;
+    Result = Result * RotZ;
+    Result = Result * RotY;
+    Result = Result * RotX;
+    Result = Result * Trans;
+    Model = Result;
+
+    Position = {};
+    vec3 OldPos = Position;
+    vec4 PosTemp = (Model * vec4(OldPos, 1.0));
+    Position = vec3(PosTemp.x, PosTemp.y, PosTemp.z);
+}
+
+void mesh::SetNewScale(vec3 NewScale)
+{
+    mat4 Result = Model;
+    mat4 Scal  = Scale(NewScale);
+    Result = Result * Scal;
+    Model = Result;
+}
+
+void mesh::SetNewTranslate(vec3 NewTranslate)
+{
+    mat4 Result = Model;
+    mat4 Trans = Translate(NewTranslate);
+    Result = Result * Trans;
+    Model = Result;
+}
+
+void mesh::SetNewRotate(vec3 NewRotate)
+{
+    mat4 Result = Model;
+    mat4 RotX  = RotateX(NewRotate.x);
+    mat4 RotY  = RotateY(NewRotate.y);
+    mat4 RotZ  = RotateZ(NewRotate.z);
+    Result = Result * RotZ;
+    Result = Result * RotY;
+    Result = Result * RotX;
+    Model = Result;
+}
+
+aabb mesh::
+GetAABB()
+{
+    if(LocalAABBVersion != GeometryVersion)
+    {
+        float MinX = std::numeric_limits<float>::max(), MinY = std::numeric_limits<float>::max(), MinZ = std::numeric_limits<float>::max();
+        float MaxX = std::numeric_limits<float>::lowest(), MaxY = std::numeric_limits<float>::lowest(), MaxZ = std::numeric_limits<float>::lowest();
+        for(const vertex& Vert : Vertices)
+        {
+            if(Vert.Pos.x < MinX) MinX = Vert.Pos.x;
+            if(Vert.Pos.y < MinY) MinY = Vert.Pos.y;
+            if(Vert.Pos.z < MinZ) MinZ = Vert.Pos.z;
+            if(Vert.Pos.x > MaxX) MaxX = Vert.Pos.x;
+            if(Vert.Pos.y > MaxY) MaxY = Vert.Pos.y;
+            if(Vert.Pos.z > MaxZ) MaxZ = Vert.Pos.z;
+        }
+        LocalAABB.Min = {MinX, MinY, MinZ};
+        LocalAABB.Max = {MaxX, MaxY, MaxZ};
+        LocalAABBVersion = GeometryVersion;
+    }
+
+    if(Vertices.empty()) return LocalAABB;
+
+    // NOTE: min and max do not stay the min and max under a rotation,
+    // so every corner of the box is moved
+    aabb Result;
+    Result.Min = vec3(std::numeric_limits<float>::max());
+    Result.Max = vec3(std::numeric_limits<float>::lowest());
+    for(uint32_t CornerIdx = 0;
+        CornerIdx < 8;
+        ++CornerIdx)
+    {
+        vec4 Corner = Model * vec4((CornerIdx & 1) ? LocalAABB.Max.x : LocalAABB.Min.x,
+                                   (CornerIdx & 2) ? LocalAABB.Max.y : LocalAABB.Min.y,
+                                   (CornerIdx & 4) ? LocalAABB.Max.z : LocalAABB.Min.z, 1.0f);
+        Result.Min = vec3(std::min(Result.Min.x, Corner.x), std::min(Result.Min.y, Corner.y), std::min(Result.Min.z, Corner.z));
+        Result.Max = vec3(std::max(Result.Max.x, Corner.x), std::max(Result.Max.y, Corner.y), std::max(Result.Max.z, Corner.z));
+    }
+
+    return Result;
+}
+
+std::vector<vec3> GetUnitCirclePositions(int SectorCount)
+{
+    float sectorStep = 2 * Pi<float> / float(SectorCount);
+    float sectorAngle;
+
+    std::vector<vec3> unitCirclePositions;
+    for(int i = 0; i <= SectorCount; ++i)
+    {
+        sectorAngle = i * sectorStep;
+        unitCirclePositions.push_back(vec3(cos(sectorAngle), 0, sin(sectorAngle)));
+    }
+    return unitCirclePositions;
+}
+
+void mesh::GenerateCylinder(int SectorCount, float Height, float Radius)
+{
+    std::vector<vec3> UnitPositions = GetUnitCirclePositions(SectorCount);
+
+    vertex Vertex(vec3(0), vec3(0), vec3(0.24f, 0.7f, 0.36f));
+
+    for (int i = 0; i < 2; ++i)
+    {
+        float TempHeight = -Height / 2.0f + i * Height;
+        for(int j = 0; j <= SectorCount; j++)
+        {
+            vec3 NewCoord = vec3(UnitPositions[j].x * Radius, TempHeight, UnitPositions[j].z * Radius);
+            vec3 NewNorm  = UnitPositions[j];
+            Vertex.Pos = vec4(NewCoord, 1.0f);
+            Vertex.Norm = NewNorm;
+            Vertices.push_back(Vertex);
+        }
+    }
+
+    int BaseCenterIndex = (int)Vertices.size();
+    int TopCenterIndex  = BaseCenterIndex + SectorCount + 1;
+
+    for(int i = 0; i < 2; i++)
+    {
+        float TempHeight = -Height / 2.0f + i * Height;
+
+        Vertex.Pos  = vec4(0, TempHeight, 0, 1.0);
+        Vertex.Norm = vec3(0, (-1 + i * 2), 0);
+        Vertices.push_back(Vertex);
+
+        for (auto j = 0; j < SectorCount; j++)
+        {
+            Vertex.Pos = vec4(UnitPositions[j] * Radius) + vec4(0, TempHeight, 0, 1.0);
+            Vertices.push_back(Vertex);
+        }
+    }
+
+    int k1 = 0;                         // 1st vertex index at base
+    int k2 = SectorCount + 1;           // 1st vertex index at top
+
+    for(int i = 0; i < SectorCount; ++i, ++k1, ++k2)
+    {
+        // 2 triangles per sector, counter clockwise seen from outside
+        // k1 => k2 => k1+1
+        VertexIndices.push_back(k1);
+        VertexIndices.push_back(k2);
+        VertexIndices.push_back(k1 + 1);
+
+        // k2 => k2+1 => k1+1
+        VertexIndices.push_back(k2);
+        VertexIndices.push_back(k2 + 1);
+        VertexIndices.push_back(k1 + 1);
+    }
+
+    // indices for the base surface
+    // NOTE: baseCenterIndex and topCenterIndices are pre-computed during vertex generation
+    for(int i = 0, k = BaseCenterIndex + 1; i < SectorCount; ++i, ++k)
+    {
+        if(i < SectorCount - 1)
+        {
+            VertexIndices.push_back(BaseCenterIndex);
+            VertexIndices.push_back(k);
+            VertexIndices.push_back(k + 1);
+        }
+        else // last triangle
+        {
+            VertexIndices.push_back(BaseCenterIndex);
+            VertexIndices.push_back(k);
+            VertexIndices.push_back(BaseCenterIndex + 1);
+        }
+    }
+
+    // indices for the top surface
+    for(int i = 0, k = TopCenterIndex + 1; i < SectorCount; ++i, ++k)
+    {
+        if(i < SectorCount - 1)
+        {
+            VertexIndices.push_back(TopCenterIndex);
+            VertexIndices.push_back(k + 1);
+            VertexIndices.push_back(k);
+        }
+        else // last triangle
+        {
+            VertexIndices.push_back(TopCenterIndex);
+            VertexIndices.push_back(TopCenterIndex + 1);
+            VertexIndices.push_back(k);
+        }
+    }
+
+    GeometryVersion++;
+}
+
+// NOTE: axis aligned cube centered at the origin, every face is a grid of
+// Divisions x Divisions quads with vertices shared inside of the face
+void mesh::GenerateSubdividedCube(int Divisions, float Size)
+{
+    const vec3 FaceAxes[6][3] =
+    {
+        // normal, u, v with u x v == normal
+        {vec3( 1, 0, 0), vec3(0, 1, 0), vec3(0, 0, 1)},
+        {vec3(-1, 0, 0), vec3(0, 0, 1), vec3(0, 1, 0)},
+        {vec3( 0, 1, 0), vec3(0, 0, 1), vec3(1, 0, 0)},
+        {vec3( 0,-1, 0), vec3(1, 0, 0), vec3(0, 0, 1)},
+        {vec3( 0, 0, 1), vec3(1, 0, 0), vec3(0, 1, 0)},
+        {vec3( 0, 0,-1), vec3(0, 1, 0), vec3(1, 0, 0)},
+    };
+
+    float HalfSize = Size / 2.0f;
+    float Step = Size / float(Divisions);
+    vertex Vertex(vec3(0), vec3(0), vec3(0.24f, 0.7f, 0.36f));
+
+    for(int Face = 0; Face < 6; ++Face)
+    {
+        vec3 Normal = FaceAxes[Face][0];
+        vec3 U = FaceAxes[Face][1];
+        vec3 V = FaceAxes[Face][2];
+
+        int FirstIndex = (int)Vertices.size();
+        for(int i = 0; i <= Divisions; ++i)
+        {
+            for(int j = 0; j <= Divisions; ++j)
+            {
+                vec3 NewCoord = Normal * HalfSize + U * (-HalfSize + i * Step) + V * (-HalfSize + j * Step);
+                Vertex.Pos = vec4(NewCoord, 1.0f);
+                Vertex.Norm = Normal;
+                Vertices.push_back(Vertex);
+            }
+        }
+
+        // 2 triangles per quad, counter clockwise seen from outside
+        for(int i = 0; i < Divisions; ++i)
+        {
+            for(int j = 0; j < Divisions; ++j)
+            {
+                int k00 = FirstIndex + i * (Divisions + 1) + j;
+                int k10 = k00 + (Divisions + 1);
+                int k01 = k00 + 1;
+                int k11 = k10 + 1;
+
+                VertexIndices.push_back(k00);
+                VertexIndices.push_back(k10);
+                VertexIndices.push_back(k11);
+
+                VertexIndices.push_back(k00);
+                VertexIndices.push_back(k11);
+                VertexIndices.push_back(k01);
+            }
+        }
+    }
+
+    GeometryVersion++;
+}
+
+// NOTE: OBJ data as it is in the file, indices are 0 based
+// NOTE: index of a corner without a texture coordinate or normal, and of an index
+// that can not be resolved
+static const uint32_t OBJ_NO_INDEX = 0xFFFFFFFF;
+
+// NOTE: TextCoordIndices and NormalIndices are empty or have one index per corner,
+// a file where only some of the faces have them has OBJ_NO_INDEX for the other corners
+struct obj_data
+{
+    std::vector<vec3> Coords;
+    std::vector<vec2> TextCoords;
+    std::vector<vec3> Normals;
+
+    std::vector<uint32_t> CoordIndices;
+    std::vector<uint32_t> TextCoordIndices;
+    std::vector<uint32_t> NormalIndices;
+};
+
+struct obj_counts
+{
+    uint32_t Coords = 0;
+    uint32_t TextCoords = 0;
+    uint32_t Normals = 0;
+    uint32_t Faces = 0;
+};
+
+// NOTE: only looks at the first two characters of every line, so it runs at about
+// the speed memchr finds the line ends. Used to reserve everything before parsing
+static obj_counts
+CountObjLines(const char* Begin, const char* End)
+{
+    obj_counts Counts;
+    const char* Line = Begin;
+    while(Line < End)
+    {
+        const char* LineEnd = (const char*)memchr(Line, '\n', End - Line);
+        if(!LineEnd) LineEnd = End;
+
+        if((LineEnd - Line >= 2) && (Line[0] == 'v'))
+        {
+            if((Line[1] == ' ') || (Line[1] == '\t')) Counts.Coords++;
+            else if(Line[1] == 't') Counts.TextCoords++;
+            else if(Line[1] == 'n') Counts.Normals++;
+        }
+        else if(Line[0] == 'f')
+        {
+            Counts.Faces++;
+        }
+        Line = LineEnd + 1;
+    }
+    return Counts;
+}
+
+static const char*
+SkipObjSpaces(const char* At, const char* End)
+{
+    while((At < End) && ((*At == ' ') || (*At == '\t') || (*At == '\r'))) ++At;
+    return At;
+}
+
+// NOTE: a value that is not there or does not parse stays 0. The stream loader kept
+// the one of the line before, a chunk does not know that line
+static const char*
+ParseObjFloats(const char* At, const char* End, float* Values, uint32_t Count)
+{
+    for(uint32_t Idx = 0;
+        Idx < Count;
+        ++Idx)
+    {
+        At = SkipObjSpaces(At, End);
+        if((At < End) && (*At == '+')) ++At;
+        std::from_chars_result Result = std::from_chars(At, End, Values[Idx]);
+        if(Result.ec != std::errc()) break;
+        At = Result.ptr;
+    }
+    return At;
+}
+
+// NOTE: a 1 based index as written in the file, negative ones count back from the end
+// of the elements read so far. 0 if there is none
+static const char*
+ParseObjIndex(const char* At, const char* End, int64_t& Index)
+{
+    Index = 0;
+    std::from_chars_result Result = std::from_chars(At, End, Index);
+    return (Result.ec == std::errc()) ? Result.ptr : At;
+}
+
+// NOTE: OBJ_NO_INDEX for a missing index and for a negative one that counts back past
+// the first element. Positive ones may point ahead, they are checked against the
+// counts of the whole file when the vertices are generated
+static uint32_t
+ResolveObjIndex(int64_t Index, uint32_t Count)
+{
+    if(Index < 0) return (Index >= -(int64_t)Count) ? (uint32_t)((int64_t)Count + Index) : OBJ_NO_INDEX;
+    if((Index == 0) || (Index > (int64_t)OBJ_NO_INDEX)) return OBJ_NO_INDEX;
+    return (uint32_t)(Index - 1);
+}
+
+// NOTE: indices of an attribute stay empty until the first corner that has one,
+// then the corners before it get OBJ_NO_INDEX. IndexCount includes the new one
+static void
+PushObjAttribIndex(std::vector<uint32_t>& Indices, size_t IndexCount, uint32_t Index)
+{
+    if(Indices.empty() && (Index == OBJ_NO_INDEX)) return;
+    Indices.resize(IndexCount - 1, OBJ_NO_INDEX);
+    Indices.push_back(Index);
+}
+
+// NOTE: faces are v, v/vt, v/vt/vn or v//vn per corner. A face with more than three
+// corners is split into a fan. Every corner has its own texture coordinate and normal
+static void
+ParseObjFace(const char* At, const char* End, const obj_counts& Base, obj_data& Data, std::vector<int64_t>& Corners)
+{
+    Corners.clear();
+    while(true)
+    {
+        At = SkipObjSpaces(At, End);
+        if(At >= End) break;
+
+        int64_t Index[3] = {};
+        const char* Next = ParseObjIndex(At, End, Index[0]);
+        if((Next < End) && (*Next == '/'))
+        {
+            Next = ParseObjIndex(Next + 1, End, Index[1]);
+            if((Next < End) && (*Next == '/'))
+                Next = ParseObjIndex(Next + 1, End, Index[2]);
+        }
+        if(Next == At) break;
+
+        Corners.insert(Corners.end(), Index, Index + 3);
+        At = Next;
+    }
+
+    uint32_t CornerCount = (uint32_t)Corners.size() / 3;
+    if(CornerCount < 3) return;
+
+    uint32_t CoordCount = Base.Coords + (uint32_t)Data.Coords.size();
+    uint32_t TextCoordCount = Base.TextCoords + (uint32_t)Data.TextCoords.size();
+    uint32_t NormalCount = Base.Normals + (uint32_t)Data.Normals.size();
+    for(uint32_t Corner = 1;
+        Corner + 1 < CornerCount;
+        ++Corner)
+    {
+        uint32_t Triangle[3] = {0, Corner, Corner + 1};
+        for(uint32_t Idx : Triangle)
+        {
+            Data.CoordIndices.push_back(ResolveObjIndex(Corners[Idx * 3 + 0], CoordCount));
+            size_t IndexCount = Data.CoordIndices.size();
+            PushObjAttribIndex(Data.TextCoordIndices, IndexCount, ResolveObjIndex(Corners[Idx * 3 + 1], TextCoordCount));
+            PushObjAttribIndex(Data.NormalIndices, IndexCount, ResolveObjIndex(Corners[Idx * 3 + 2], NormalCount));
+        }
+    }
+}
+
+// NOTE: lines the stream loader skipped (comments, groups, materials) are skipped too.
+// Base is the number of elements the lines before Begin defined, negative
+// indices of the faces count back from there
+static void
+ParseObjLines(const char* Begin, const char* End, const obj_counts& Base, obj_data& Data)
+{
+    std::vector<int64_t> Corners;
+
+    const char* Line = Begin;
+    while(Line < End)
+    {
+        const char* LineEnd = (const char*)memchr(Line, '\n', End - Line);
+        if(!LineEnd) LineEnd = End;
+
+        if((LineEnd - Line >= 2) && (Line[0] == 'v'))
+        {
+            if((Line[1] == ' ') || (Line[1] == '\t'))
+            {
+                vec3 Coord = {};
+                ParseObjFloats(Line + 1, LineEnd, &Coord[0], 3);
+                Data.Coords.push_back(Coord);
+            }
+            else if(Line[1] == 'n')
+            {
+                vec3 Normal = {};
+                ParseObjFloats(Line + 2, LineEnd, &Normal[0], 3);
+                Data.Normals.push_back(Normal);
+            }
+            else if(Line[1] == 't')
+            {
+                vec2 TextCoord = {};
+                ParseObjFloats(Line + 2, LineEnd, &TextCoord[0], 2);
+                Data.TextCoords.push_back(TextCoord);
+            }
+        }
+        else if(Line[0] == 'f')
+        {
+            ParseObjFace(Line + 1, LineEnd, Base, Data, Corners);
+        }
+        Line = LineEnd + 1;
+    }
+}
+
+// NOTE: one vertex per different position and normal, in the order they are first used.
+// Most corners use the same position and normal index as a corner before them,
+// the vertex of the last pair of every position index is kept so that those
+// are found without hashing the vertex.
+// Every index is checked: a triangle with a position that is not in the file is
+// skipped, a corner without a normal or with one that is not in the file gets a zero normal
+static void
+GenerateObjVertices(mesh& Mesh, const obj_data& Data)
+{
+    std::unordered_map<vertex, uint32_t> UniqueVertices;
+    UniqueVertices.reserve(Data.Coords.size());
+    Mesh.Vertices.reserve(Mesh.Vertices.size() + Data.Coords.size());
+
+    uint32_t IndexCount = Data.CoordIndices.size() / 3 * 3;
+    std::vector<uint32_t> Indices;
+    Indices.reserve(IndexCount);
+
+    // NOTE: normal index in the high half, vertex index in the low one
+    std::vector<uint64_t> LastVertexOfCoord(Data.Coords.size(), ~0ull);
+
+    for(uint32_t FirstIndex = 0;
+        FirstIndex < IndexCount;
+        FirstIndex += 3)
+    {
+        const uint32_t* CoordIndices = &Data.CoordIndices[FirstIndex];
+        if((CoordIndices[0] >= Data.Coords.size()) ||
+           (CoordIndices[1] >= Data.Coords.size()) ||
+           (CoordIndices[2] >= Data.Coords.size()))
+            continue;
+
+        for(uint32_t VertexIndex = FirstIndex;
+            VertexIndex < FirstIndex + 3;
+            ++VertexIndex)
+        {
+            uint32_t CoordIndex = Data.CoordIndices[VertexIndex];
+            uint32_t NormalIndex = (VertexIndex < Data.NormalIndices.size()) ? Data.NormalIndices[VertexIndex] : OBJ_NO_INDEX;
+            if(NormalIndex >= Data.Normals.size()) NormalIndex = OBJ_NO_INDEX;
+
+            uint64_t& LastVertex = LastVertexOfCoord[CoordIndex];
+            if((LastVertex != ~0ull) && ((uint32_t)(LastVertex >> 32) == NormalIndex))
+            {
+                Indices.push_back((uint32_t)LastVertex);
+                continue;
+            }
+
+            vertex Vert(vec4(0), vec3(0), vec3(0.24, 0.7, 0.36));
+
+            vec3 Pos = Data.Coords[CoordIndex];
+            Vert.Pos = vec4(Pos, 1.0);
+
+            if(NormalIndex != OBJ_NO_INDEX)
+            {
+                vec3 Norm = Data.Normals[NormalIndex];
+                Vert.Norm = Norm;
+            }
+
+            auto [It, IsNew] = UniqueVertices.try_emplace(Vert, static_cast<uint32_t>(Mesh.Vertices.size()));
+            if(IsNew) Mesh.Vertices.push_back(Vert);
+
+            Indices.push_back(It->second);
+            LastVertex = ((uint64_t)NormalIndex << 32) | It->second;
+        }
+    }
+
+    Mesh.Positions.insert(Mesh.Positions.begin(), Data.Coords.begin(), Data.Coords.end());
+    Mesh.VertexIndices.insert(Mesh.VertexIndices.end(), Indices.begin(), Indices.end());
+    Mesh.GeometryVersion++;
+}
+
+static void
+ReserveObjData(obj_data& Data, const obj_counts& Counts)
+{
+    Data.Coords.reserve(Counts.Coords);
+    Data.TextCoords.reserve(Counts.TextCoords);
+    Data.Normals.reserve(Counts.Normals);
+    Data.CoordIndices.reserve(Counts.Faces * 3);
+    Data.TextCoordIndices.reserve(Counts.TextCoords ? Counts.Faces * 3 : 0);
+    Data.NormalIndices.reserve(Counts.Normals ? Counts.Faces * 3 : 0);
+}
+
+template<typename T>
+static void
+AppendObjArray(std::vector<T>& Array, const std::vector<T>& Chunk)
+{
+    Array.insert(Array.end(), Chunk.begin(), Chunk.end());
+}
+
+// NOTE: keeps the indices of an attribute empty or one per corner, as a single pass would.
+// IndexCount is the number of corner indices before the chunk, NewIndexCount the one after it
+static void
+AppendObjAttribIndices(std::vector<uint32_t>& Indices, size_t IndexCount,
+                       const std::vector<uint32_t>& Chunk, size_t NewIndexCount)
+{
+    if(Indices.empty() && Chunk.empty()) return;
+    Indices.resize(IndexCount, OBJ_NO_INDEX);
+    AppendObjArray(Indices, Chunk);
+    Indices.resize(NewIndexCount, OBJ_NO_INDEX);
+}
+
+// NOTE: the first chunk runs on the calling thread
+static void
+ForEachObjChunk(task_pool* Pool, uint32_t ChunkCount, const std::function<void(uint32_t)>& Func)
+{
+    if(!Pool || (ChunkCount == 1))
+    {
+        for(uint32_t Chunk = 0; Chunk < ChunkCount; ++Chunk) Func(Chunk);
+        return;
+    }
+
+    task_group Group;
+    for(uint32_t Chunk = 1; Chunk < ChunkCount; ++Chunk)
+        Pool->Submit(Group, [&Func, Chunk]() { Func(Chunk); });
+    Func(0);
+    Pool->Wait(Group);
+}
+
+// NOTE: the file is mapped and parsed in place, numbers are read with from_chars.
+// With a pool, a big file is cut into chunks that start after a line end and the
+// chunks are parsed as tasks. A first pass counts the lines of every chunk. The
+// prefix sum of the counts is what the chunks before a chunk defined, which its
+// negative face indices count back from and where its elements go in the whole.
+// Chunks are appended in file order, so the result is the same as in one piece
+void mesh::
+LoadMesh(const std::string& Path, task_pool* Pool)
+{
+    mapped_file File;
+    if(!MapFile(File, Path.c_str())) return;
+
+    const char* Begin = File.Data;
+    const char* End = File.Data + File.Size;
+
+    // NOTE: a pool without workers would only add the cost of merging the chunks
+    uint32_t ChunkCount = 1;
+    if(Pool && Pool->GetThreadCount())
+    {
+        size_t MaxChunkCount = (Pool->GetThreadCount() + 1) * OBJ_CHUNKS_PER_THREAD;
+        ChunkCount = (uint32_t)std::clamp<size_t>(File.Size / OBJ_MIN_CHUNK_SIZE, 1, MaxChunkCount);
+    }
+
+    std::vector<const char*> ChunkBegins(ChunkCount + 1);
+    ChunkBegins[0] = Begin;
+    ChunkBegins[ChunkCount] = End;
+    for(uint32_t Chunk = 1;
+        Chunk < ChunkCount;
+        ++Chunk)
+    {
+        const char* At = std::max(Begin + File.Size / ChunkCount * Chunk, ChunkBegins[Chunk - 1]);
+        const char* LineEnd = (const char*)memchr(At, '\n', End - At);
+        ChunkBegins[Chunk] = LineEnd ? LineEnd + 1 : End;
+    }
+
+    std::vector<obj_counts> Counts(ChunkCount);
+    ForEachObjChunk(Pool, ChunkCount, [&](uint32_t Chunk)
+    {
+        Counts[Chunk] = CountObjLines(ChunkBegins[Chunk], ChunkBegins[Chunk + 1]);
+    });
+
+    std::vector<obj_counts> Bases(ChunkCount);
+    obj_counts Total;
+    for(uint32_t Chunk = 0;
+        Chunk < ChunkCount;
+        ++Chunk)
+    {
+        Bases[Chunk] = Total;
+        Total.Coords     += Counts[Chunk].Coords;
+        Total.TextCoords += Counts[Chunk].TextCoords;
+        Total.Normals    += Counts[Chunk].Normals;
+        Total.Faces      += Counts[Chunk].Faces;
+    }
+
+    std::vector<obj_data> Chunks(ChunkCount);
+    ForEachObjChunk(Pool, ChunkCount, [&](uint32_t Chunk)
+    {
+        ReserveObjData(Chunks[Chunk], Counts[Chunk]);
+        ParseObjLines(ChunkBegins[Chunk], ChunkBegins[Chunk + 1], Bases[Chunk], Chunks[Chunk]);
+    });
+    UnmapFile(File);
+
+    obj_data Data = std::move(Chunks[0]);
+    if(ChunkCount > 1)
+    {
+        ReserveObjData(Data, Total);
+        for(uint32_t Chunk = 1;
+            Chunk < ChunkCount;
+            ++Chunk)
+        {
+            AppendObjArray(Data.Coords, Chunks[Chunk].Coords);
+            AppendObjArray(Data.TextCoords, Chunks[Chunk].TextCoords);
+            AppendObjArray(Data.Normals, Chunks[Chunk].Normals);
+            size_t IndexCount = Data.CoordIndices.size();
+            AppendObjArray(Data.CoordIndices, Chunks[Chunk].CoordIndices);
+            AppendObjAttribIndices(Data.TextCoordIndices, IndexCount, Chunks[Chunk].TextCoordIndices, Data.CoordIndices.size());
+            AppendObjAttribIndices(Data.NormalIndices, IndexCount, Chunks[Chunk].NormalIndices, Data.CoordIndices.size());
+            Chunks[Chunk] = {};
+        }
+    }
+
+    GenerateObjVertices(*this, Data);
+}
+
+// NOTE: the getline loader LoadMesh had before, kept for csgbench to compare with
+void mesh::
+LoadMeshStream(const std::string& Path)
+{
+    obj_data Data;
+    std::vector<vec3>& Coords = Data.Coords;
+    std::vector<vec2>& TextCoords = Data.TextCoords;
+    std::vector<vec3>& Normals = Data.Normals;
+
+    std::vector<uint32_t>& CoordIndices = Data.CoordIndices;
+    std::vector<uint32_t>& TextCoordIndices = Data.TextCoordIndices;
+    std::vector<uint32_t>& NormalIndices = Data.NormalIndices;
+
+    std::ifstream File(Path);
+    if(File.is_open())
+    {
+        std::string Content;
+        vec3 Vertex3 = {};
+        vec2 Vertex2 = {};
+        while (std::getline(File, Content))
+        {
+            if (Content[0] == '#' || Content[0] == 'm' || Content[0] == 'o' || Content[0] == 'u' || Content[0] == 's') continue;
+            if (Content.rfind("v ", 0) != std::string::npos)
+            {
+                sscanf(Content.c_str(), "v %f %f %f", &Vertex3[0], &Vertex3[1], &Vertex3[2]);
+                Coords.push_back(Vertex3);
+            }
+            if (Content.rfind("vn", 0) != std::string::npos)
+            {
+                sscanf(Content.c_str(), "vn %f %f %f", &Vertex3[0], &Vertex3[1], &Vertex3[2]);
+                Normals.push_back(Vertex3);
+            }
+            if (Content.rfind("vt", 0) != std::string::npos)
+            {
+                sscanf(Content.c_str(), "vt %f %f", &Vertex2[0], &Vertex2[1]);
+                TextCoords.push_back(Vertex2);
+            }
+            if (Content[0] == 'f')
+            {
+                uint32_t Indices[3][3] = {};
+                char* ToParse = const_cast<char*>(Content.c_str()) + 1;
+
+                int Idx = 0;
+                int Type = 0;
+                while(*ToParse++)
+                {
+                    if(*ToParse != '/')
+                    {
+                        Indices[Type][Idx] = atoi(ToParse);
+                    }
+
+                    while ((*ToParse != ' ') && (*ToParse != '/') && (*ToParse))
+                    {
+                        ToParse++;
+                    }
+
+                    if(*ToParse == '/')
+                    {
+                        Type++;
+                    }
+                    if(*ToParse == ' ')
+                    {
+                        Type = 0;
+                        Idx++;
+                    }
+                }
+
+                CoordIndices.push_back(Indices[0][0]-1);
+                CoordIndices.push_back(Indices[0][1]-1);
+                CoordIndices.push_back(Indices[0][2]-1);
+                if (Indices[1][0] != 0)
+                {
+                    TextCoordIndices.push_back(Indices[1][0]-1);
+                    TextCoordIndices.push_back(Indices[1][1]-1);
+                    TextCoordIndices.push_back(Indices[1][2]-1);
+                }
+                if (Indices[2][0] != 0)
+                {
+                    NormalIndices.push_back(Indices[2][0]-1);
+                    NormalIndices.push_back(Indices[2][1]-1);
+                    NormalIndices.push_back(Indices[2][2]-1);
+                }
+            }
+        }
+    }
+
+    GenerateObjVertices(*this, Data);
+}
+
+polygon_soup mesh::
+GeneratePolygons(const std::vector<uint32_t>& Indices)
+{
+    return GeneratePolygons(Indices, Model);
+}
+
+polygon_soup mesh::
+GeneratePolygons(const std::vector<uint32_t>& Indices, mat4 Transform)
+{
+    polygon_soup Result;
+    uint32_t PolygonCount = Indices.size() / 3;
+    for(uint32_t VertIdx = 0;
+        VertIdx < 3;
+        ++VertIdx)
+    {
+        Result.X[VertIdx].resize(PolygonCount);
+        Result.Y[VertIdx].resize(PolygonCount);
+        Result.Z[VertIdx].resize(PolygonCount);
+    }
+    Result.Attribs.resize(PolygonCount * 3);
+
+    mat3 NormalMat = Transform.GetMat3();
+    for(uint32_t Idx = 0;
+        Idx < PolygonCount;
+        Idx++)
+    {
+        for(uint32_t VertIdx = 0;
+            VertIdx < 3;
+            ++VertIdx)
+        {
+            const vertex& Vert = Vertices[Indices[Idx * 3 + VertIdx]];
+            vec4 Pos = Transform * Vert.Pos;
+            Result.X[VertIdx][Idx] = Pos.x;
+            Result.Y[VertIdx][Idx] = Pos.y;
+            Result.Z[VertIdx][Idx] = Pos.z;
+            Result.Attribs[Idx * 3 + VertIdx].Norm = NormalMat * Vert.Norm;
+            Result.Attribs[Idx * 3 + VertIdx].Col  = Vert.Col;
+        }
+    }
+
+    return Result;
+}
+
+std::vector<vec3> mesh::
+GenerateShape(std::vector<uint32_t> Indices)
+{
+    std::unordered_set<vec3> Shape;
+    vertex NewVertA = {};
+    vertex NewVertB = {};
+    vertex NewVertC = {};
+    vec3 A, B, C;
+    for(uint32_t Idx = 0;
+        Idx < Indices.size() / 3;
+        Idx++)
+    {
+        uint32_t VertIdx0 = Indices[Idx * 3 + 0];
+        uint32_t VertIdx1 = Indices[Idx * 3 + 1];
+        uint32_t VertIdx2 = Indices[Idx * 3 + 2];
+        NewVertA = Vertices[VertIdx0];
+        NewVertB = Vertices[VertIdx1];
+        NewVertC = Vertices[VertIdx2];
+        A = (Model * NewVertA.Pos).xyz;
+        B = (Model * NewVertB.Pos).xyz;
+        C = (Model * NewVertC.Pos).xyz;
+        Shape.insert(A);
+        Shape.insert(B);
+        Shape.insert(C);
+    }
+
+    std::vector<vec3> Result(Shape.begin(), Shape.end());
+    return Result;
+}
+
+void polygon_soup::
+Reserve(uint32_t Count)
+{
+    for(uint32_t VertIdx = 0;
+        VertIdx < 3;
+        ++VertIdx)
+    {
+        X[VertIdx].reserve(Count);
+        Y[VertIdx].reserve(Count);
+        Z[VertIdx].reserve(Count);
+    }
+    Attribs.reserve(Count * 3);
+}
+
+void polygon_soup::
+Grow(uint32_t MinCount)
+{
+    // NOTE: all arrays are grown together, so there is exactly one grow per counted allocation
+    GrowCount++;
+    Reserve(std::max<uint32_t>(MinCount, Capacity() * 2));
+}
+
+void polygon_soup::
+Clear()
+{
+    for(uint32_t VertIdx = 0;
+        VertIdx < 3;
+        ++VertIdx)
+    {
+        X[VertIdx].clear();
+        Y[VertIdx].clear();
+        Z[VertIdx].clear();
+    }
+    Attribs.clear();
+}
+
+void polygon_soup::
+Push(const polygon& Poly)
+{
+    if(Size() == Capacity()) Grow(Size() + 1);
+    for(uint32_t VertIdx = 0;
+        VertIdx < 3;
+        ++VertIdx)
+    {
+        X[VertIdx].push_back(Poly.V[VertIdx].Pos.x);
+        Y[VertIdx].push_back(Poly.V[VertIdx].Pos.y);
+        Z[VertIdx].push_back(Poly.V[VertIdx].Pos.z);
+        Attribs.push_back({Poly.V[VertIdx].Norm, Poly.V[VertIdx].Col});
+    }
+}
+
+void polygon_soup::
+Push(const polygon_soup& Src, uint32_t Idx)
+{
+    if(Size() == Capacity()) Grow(Size() + 1);
+    for(uint32_t VertIdx = 0;
+        VertIdx < 3;
+        ++VertIdx)
+    {
+        X[VertIdx].push_back(Src.X[VertIdx][Idx]);
+        Y[VertIdx].push_back(Src.Y[VertIdx][Idx]);
+        Z[VertIdx].push_back(Src.Z[VertIdx][Idx]);
+    }
+    Attribs.insert(Attribs.end(), Src.Attribs.begin() + Idx * 3, Src.Attribs.begin() + Idx * 3 + 3);
+}
+
+void polygon_soup::
+Push(vec3 A, vec3 B, vec3 C, const vertex_attribs& AttribsA, const vertex_attribs& AttribsB, const vertex_attribs& AttribsC)
+{
+    if(Size() == Capacity()) Grow(Size() + 1);
+    X[0].push_back(A.x);
+    Y[0].push_back(A.y);
+    Z[0].push_back(A.z);
+    X[1].push_back(B.x);
+    Y[1].push_back(B.y);
+    Z[1].push_back(B.z);
+    X[2].push_back(C.x);
+    Y[2].push_back(C.y);
+    Z[2].push_back(C.z);
+    Attribs.push_back(AttribsA);
+    Attribs.push_back(AttribsB);
+    Attribs.push_back(AttribsC);
+}
+
+void polygon_soup::
+Append(const polygon_soup& Src, uint32_t First, uint32_t Count)
+{
+    if(Size() + Count > Capacity()) Grow(Size() + Count);
+    for(uint32_t VertIdx = 0;
+        VertIdx < 3;
+        ++VertIdx)
+    {
+        X[VertIdx].insert(X[VertIdx].end(), Src.X[VertIdx].begin() + First, Src.X[VertIdx].begin() + First + Count);
+        Y[VertIdx].insert(Y[VertIdx].end(), Src.Y[VertIdx].begin() + First, Src.Y[VertIdx].begin() + First + Count);
+        Z[VertIdx].insert(Z[VertIdx].end(), Src.Z[VertIdx].begin() + First, Src.Z[VertIdx].begin() + First + Count);
+    }
+    Attribs.insert(Attribs.end(), Src.Attribs.begin() + First * 3, Src.Attribs.begin() + (First + Count) * 3);
+}
+
+void polygon_soup::
+Transform(mat4 Transform)
+{
+    mat3 NormalMat = Transform.GetMat3();
+    for(uint32_t VertIdx = 0;
+        VertIdx < 3;
+        ++VertIdx)
+    {
+        for(uint32_t Idx = 0;
+            Idx < Size();
+            ++Idx)
+        {
+            vec4 Pos = Transform * vec4(GetPos(Idx, VertIdx), 1);
+            X[VertIdx][Idx] = Pos.x;
+            Y[VertIdx][Idx] = Pos.y;
+            Z[VertIdx][Idx] = Pos.z;
+        }
+    }
+
+    for(vertex_attribs& Attrib : Attribs)
+    {
+        Attrib.Norm = NormalMat * Attrib.Norm;
+    }
+}
+
+polygon polygon_soup::
+Get(uint32_t Idx) const
+{
+    polygon Result;
+    for(uint32_t VertIdx = 0;
+        VertIdx < 3;
+        ++VertIdx)
+    {
+        Result.V[VertIdx].Pos  = vec4(GetPos(Idx, VertIdx), 1);
+        Result.V[VertIdx].Norm = Attribs[Idx * 3 + VertIdx].Norm;
+        Result.V[VertIdx].Col  = Attribs[Idx * 3 + VertIdx].Col;
+    }
+    return Result;
+}
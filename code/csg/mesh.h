@@ -0,0 +1,207 @@
+#ifndef MESH_H
+#define MESH_H
+
+#include "mat_h.hpp"
+#include "taskpool.h"
+
+#include <unordered_map>
+#include <unordered_set>
+#include <fstream>
+#include <string>
+
+// NOTE: a file is parsed in chunks of at least this size, and in at most
+// this many chunks per thread of the pool, so a slow chunk is balanced by the others
+const size_t OBJ_MIN_CHUNK_SIZE = 1 << 20;
+const size_t OBJ_CHUNKS_PER_THREAD = 4;
+
+struct aabb
+{
+    vec3 Min;
+    vec3 Max;
+};
+
+struct vertex
+{
+    v4<float> Pos;
+    v3<float> Norm;
+    v3<float> Col;
+
+    bool operator==(const vertex& rhs) const
+    {
+        bool Res1 = this->Pos == rhs.Pos;
+        bool Res3 = this->Norm == rhs.Norm;
+
+        return Res1 && Res3;
+    }
+};
+
+struct polygon
+{
+    vertex V[3];
+    polygon() = default;
+    polygon(vec3 A, vec3 B, vec3 C, vec3 Norm, vec3 Col)
+    {
+        V[0].Pos  = vec4(A, 1);
+        V[0].Norm = Norm;
+        V[0].Col  = Col;
+        V[1].Pos  = vec4(B, 1);
+        V[1].Norm = Norm;
+        V[1].Col  = Col;
+        V[2].Pos  = vec4(C, 1);
+        V[2].Norm = Norm;
+        V[2].Col  = Col;
+    }
+
+    polygon(vec3 A, vec3 B, vec3 C, vec3 Norm0, vec3 Norm1, vec3 Norm2, vec3 Col)
+    {
+        V[0].Pos  = vec4(A, 1);
+        V[0].Norm = Norm0;
+        V[0].Col  = Col;
+        V[1].Pos  = vec4(B, 1);
+        V[1].Norm = Norm1;
+        V[1].Col  = Col;
+        V[2].Pos  = vec4(C, 1);
+        V[2].Norm = Norm2;
+        V[2].Col  = Col;
+    }
+
+    vertex& operator[](uint32_t Idx)
+    {
+        return V[Idx];
+    }
+
+    vertex operator[](uint32_t Idx) const
+    {
+        return V[Idx];
+    }
+
+    bool operator==(const polygon& rhs) const
+    {
+        bool Res1 = (*this)[0] == rhs[0];
+        bool Res2 = (*this)[1] == rhs[1];
+        bool Res3 = (*this)[2] == rhs[2];
+
+        return Res1 && Res2 && Res3;
+    }
+};
+
+struct vertex_attribs
+{
+    v3<float> Norm;
+    v3<float> Col;
+};
+
+// NOTE: the same polygons as std::vector<polygon>, but stored as structure of arrays.
+// X[VertIdx][Idx] is the x coordinate of vertex VertIdx of polygon Idx, so plane tests
+// only stream the 9 position arrays and load them with contiguous vector loads.
+// Normals and colors are only needed when the output mesh is generated and live apart
+// in Attribs[Idx * 3 + VertIdx]. W of every position is 1
+struct polygon_soup
+{
+    std::vector<float> X[3];
+    std::vector<float> Y[3];
+    std::vector<float> Z[3];
+    std::vector<vertex_attribs> Attribs;
+
+    // NOTE: number of times a push or append had to grow the arrays.
+    // Every grow reallocates all arrays at once, so a zero here means
+    // the writes into a reserved soup did not touch the heap
+    uint32_t GrowCount = 0;
+
+    uint32_t Size() const { return X[0].size(); }
+    uint32_t Capacity() const { return X[0].capacity(); }
+    void Reserve(uint32_t Count);
+    void Clear();
+
+    void Push(const polygon& Poly);
+    void Push(const polygon_soup& Src, uint32_t Idx);
+    void Push(vec3 A, vec3 B, vec3 C, const vertex_attribs& AttribsA, const vertex_attribs& AttribsB, const vertex_attribs& AttribsC);
+    void Append(const polygon_soup& Src, uint32_t First, uint32_t Count);
+    void Append(const polygon_soup& Src) { Append(Src, 0, Src.Size()); }
+    void Grow(uint32_t MinCount);
+
+    // NOTE: positions are moved as points, normals by the upper 3x3 part
+    // the same way GeneratePolygons does it
+    void Transform(mat4 Transform);
+
+    vec3 GetPos(uint32_t Idx, uint32_t VertIdx) const
+    {
+        return vec3(X[VertIdx][Idx], Y[VertIdx][Idx], Z[VertIdx][Idx]);
+    }
+    polygon Get(uint32_t Idx) const;
+};
+
+namespace std
+{
+template<>
+struct hash<vertex>
+{
+    size_t operator()(const vertex& VertData) const
+    {
+        size_t res = 0;
+        std::hash_combine(res, hash<decltype(VertData.Pos)>{}(VertData.Pos));
+        std::hash_combine(res, hash<decltype(VertData.Norm)>{}(VertData.Norm));
+        return res;
+    }
+};
+template<>
+struct hash<polygon>
+{
+    size_t operator()(const polygon& Poly) const
+    {
+        size_t res = 0;
+        std::hash_combine(res, hash<decltype(Poly[0])>{}(Poly[0]));
+        std::hash_combine(res, hash<decltype(Poly[1])>{}(Poly[1]));
+        std::hash_combine(res, hash<decltype(Poly[2])>{}(Poly[2]));
+        return res;
+    }
+};
+}
+
+
+class mesh
+{
+public:
+    mesh() = default;
+    mesh(vec3 NewScale, vec3 NewTranslate, vec3 NewRotate);
+    void SetNewTransform(vec3 NewScale, vec3 NewTranslate, vec3 NewRotate);
+    void SetNewScale(vec3 NewScale);
+    void SetNewTranslate(vec3 NewTranslate);
+    void SetNewRotate(vec3 NewRotate);
+
+    // NOTE: a null Pool parses the file on the calling thread only
+    void LoadMesh(const std::string& Path, task_pool* Pool = &task_pool::Get());
+    void LoadMeshStream(const std::string& Path);
+    void GenerateCylinder(int SectorCount, float Height, float Radius);
+    void GenerateSubdividedCube(int Divisions, float Size);
+    polygon_soup GeneratePolygons(const std::vector<uint32_t>& Indices);
+    polygon_soup GeneratePolygons(const std::vector<uint32_t>& Indices, mat4 Transform);
+    std::vector<vec3> GenerateShape(std::vector<uint32_t> Indices);
+
+    void UpdateColor(const vec3 NewCol);
+
+    // NOTE: world space bounds of the mesh, they stay a bound under any Model
+    aabb GetAABB();
+
+    std::vector<vec3> Positions;
+    std::vector<unsigned int> Indices;
+
+    std::vector<vertex> Vertices;
+    std::vector<unsigned int> VertexIndices;
+
+    vec3 Position = {};
+    mat4 Model = {};
+
+    // NOTE: bumped every time Vertices or VertexIndices change,
+    // so that cached data built from them can be invalidated.
+    // A change of the colors only bumps ColorVersion, trees, shapes and
+    // bounding volumes do not depend on them
+    uint64_t GeometryVersion = 0;
+    uint64_t ColorVersion = 0;
+
+    // NOTE: mesh space bounds of Vertices for GeometryVersion == LocalAABBVersion
+    aabb LocalAABB = {};
+    uint64_t LocalAABBVersion = ~0ull;
+};
+
+#endif // MESH_H
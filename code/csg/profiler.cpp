@@ -0,0 +1,222 @@
+#include "profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+profiler GlobalProfiler;
+
+uint64_t
+ProfilerGetTime()
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void
+ProfilerSetEnabled(bool Enabled)
+{
+    if(GlobalProfiler.IsEnabled.load() == Enabled) return;
+
+    for(uint32_t Stage = 0; Stage < profile_stage_count; ++Stage)
+    {
+        GlobalProfiler.FrameNs[Stage].store(0);
+        std::fill(GlobalProfiler.History[Stage], GlobalProfiler.History[Stage] + PROFILE_HISTORY_SIZE, 0);
+    }
+    GlobalProfiler.FrameCount = 0;
+    GlobalProfiler.FrameStart = 0;
+    GlobalProfiler.IsEnabled.store(Enabled);
+}
+
+void
+ProfilerBeginFrame()
+{
+    if(!GlobalProfiler.IsEnabled.load(std::memory_order_relaxed)) return;
+    GlobalProfiler.FrameStart = ProfilerGetTime();
+}
+
+void
+ProfilerEndFrame()
+{
+    if(!GlobalProfiler.IsEnabled.load(std::memory_order_relaxed)) return;
+
+    if(GlobalProfiler.FrameStart)
+    {
+        uint64_t FrameEnd = ProfilerGetTime();
+        GlobalProfiler.FrameNs[profile_frame].fetch_add(FrameEnd - GlobalProfiler.FrameStart, std::memory_order_relaxed);
+        if(GlobalProfiler.IsTracing.load(std::memory_order_relaxed))
+            ProfilerRecordEvent(profile_frame, GlobalProfiler.FrameStart, FrameEnd);
+    }
+    GlobalProfiler.FrameStart = 0;
+
+    uint32_t Slot = GlobalProfiler.FrameCount % PROFILE_HISTORY_SIZE;
+    for(uint32_t Stage = 0; Stage < profile_stage_count; ++Stage)
+        GlobalProfiler.History[Stage][Slot] = GlobalProfiler.FrameNs[Stage].exchange(0, std::memory_order_relaxed);
+    GlobalProfiler.FrameCount++;
+
+    ProfilerFlushTrace();
+}
+
+const char*
+GetProfileStageName(profile_stage Stage)
+{
+    switch(Stage)
+    {
+        case profile_frame:             return "frame";
+        case profile_tree_build:        return "tree build";
+        case profile_collision:         return "collision";
+        case profile_subtract:          return "subtract";
+        case profile_generate_vertices: return "generate vertices";
+        case profile_upload:            return "upload";
+        case profile_draw:              return "draw";
+        case profile_stage_count:       break;
+    }
+    return "unknown";
+}
+
+// NOTE: nearest rank percentiles over the frames in the history
+profile_stats
+ProfilerGetStats(profile_stage Stage)
+{
+    profile_stats Result;
+    Result.SampleCount = (uint32_t)std::min<uint64_t>(GlobalProfiler.FrameCount, PROFILE_HISTORY_SIZE);
+    if(Result.SampleCount == 0) return Result;
+
+    uint64_t Samples[PROFILE_HISTORY_SIZE];
+    std::copy(GlobalProfiler.History[Stage], GlobalProfiler.History[Stage] + Result.SampleCount, Samples);
+    std::sort(Samples, Samples + Result.SampleCount);
+
+    Result.P50Ns = Samples[(Result.SampleCount * 50 + 99) / 100 - 1];
+    Result.P99Ns = Samples[(Result.SampleCount * 99 + 99) / 100 - 1];
+    Result.MaxNs = Samples[Result.SampleCount - 1];
+    return Result;
+}
+
+size_t
+ProfilerFormatStats(char* Buffer, size_t BufferSize)
+{
+    size_t Length = 0;
+    auto Append = [&](int Written)
+    {
+        if(Written > 0) Length = std::min(Length + (size_t)Written, BufferSize ? BufferSize - 1 : 0);
+    };
+
+    uint32_t SampleCount = (uint32_t)std::min<uint64_t>(GlobalProfiler.FrameCount, PROFILE_HISTORY_SIZE);
+    Append(snprintf(Buffer + Length, BufferSize - Length, "%-18s %8s %8s %8s  (%u frames)\n",
+                    "stage", "p50 ms", "p99 ms", "max ms", SampleCount));
+    for(uint32_t Stage = 0; Stage < profile_stage_count; ++Stage)
+    {
+        profile_stats Stats = ProfilerGetStats(profile_stage(Stage));
+        Append(snprintf(Buffer + Length, BufferSize - Length, "%-18s %8.3f %8.3f %8.3f\n",
+                        GetProfileStageName(profile_stage(Stage)),
+                        Stats.P50Ns / 1e6, Stats.P99Ns / 1e6, Stats.MaxNs / 1e6));
+    }
+    return Length;
+}
+
+uint32_t
+ProfilerGetThreadId()
+{
+    static std::atomic<uint32_t> NextThreadId = 1;
+    static thread_local uint32_t ThreadId = NextThreadId.fetch_add(1, std::memory_order_relaxed);
+    return ThreadId;
+}
+
+void
+ProfilerSetThreadName(const char* Name)
+{
+    uint32_t ThreadId = ProfilerGetThreadId();
+
+    std::lock_guard<std::mutex> Lock(GlobalProfiler.TraceMutex);
+    if(GlobalProfiler.ThreadNames.size() <= ThreadId)
+    {
+        GlobalProfiler.ThreadNames.resize(ThreadId + 1);
+        GlobalProfiler.IsThreadNameWritten.resize(ThreadId + 1, false);
+    }
+    GlobalProfiler.ThreadNames[ThreadId] = Name;
+    GlobalProfiler.IsThreadNameWritten[ThreadId] = false;
+}
+
+// NOTE: the file starts with the process name, so every event after it
+// can be written with a leading comma
+bool
+ProfilerStartTrace(const char* Path)
+{
+    ProfilerStopTrace();
+
+    FILE* File = fopen(Path, "wb");
+    if(!File) return false;
+    fprintf(File, "[{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"csg\"}}");
+
+    {
+        std::lock_guard<std::mutex> Lock(GlobalProfiler.TraceMutex);
+        GlobalProfiler.TraceFile = File;
+        GlobalProfiler.TraceStart = ProfilerGetTime();
+        GlobalProfiler.TraceEvents.clear();
+        std::fill(GlobalProfiler.IsThreadNameWritten.begin(), GlobalProfiler.IsThreadNameWritten.end(), false);
+    }
+    GlobalProfiler.IsTracing.store(true);
+    ProfilerSetEnabled(true);
+    return true;
+}
+
+// NOTE: events that started before the trace are dropped, the viewer
+// does not handle negative times well
+void
+ProfilerRecordEvent(profile_stage Stage, uint64_t StartNs, uint64_t EndNs)
+{
+    uint32_t ThreadId = ProfilerGetThreadId();
+
+    std::lock_guard<std::mutex> Lock(GlobalProfiler.TraceMutex);
+    if(!GlobalProfiler.TraceFile || (StartNs < GlobalProfiler.TraceStart)) return;
+    GlobalProfiler.TraceEvents.push_back({StartNs, EndNs, ThreadId, Stage});
+}
+
+// NOTE: complete events ("ph":"X") with times in microseconds since the start of the trace.
+// A thread gets its name written before its first event
+void
+ProfilerFlushTrace()
+{
+    std::lock_guard<std::mutex> Lock(GlobalProfiler.TraceMutex);
+    FILE* File = GlobalProfiler.TraceFile;
+    if(!File) return;
+
+    for(const profile_event& Event : GlobalProfiler.TraceEvents)
+    {
+        if(GlobalProfiler.IsThreadNameWritten.size() <= Event.ThreadId)
+        {
+            GlobalProfiler.ThreadNames.resize(Event.ThreadId + 1);
+            GlobalProfiler.IsThreadNameWritten.resize(Event.ThreadId + 1, false);
+        }
+        if(!GlobalProfiler.IsThreadNameWritten[Event.ThreadId])
+        {
+            const std::string& Name = GlobalProfiler.ThreadNames[Event.ThreadId];
+            if(Name.empty())
+                fprintf(File, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"thread %u\"}}",
+                        Event.ThreadId, Event.ThreadId);
+            else
+                fprintf(File, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+                        Event.ThreadId, Name.c_str());
+            GlobalProfiler.IsThreadNameWritten[Event.ThreadId] = true;
+        }
+
+        fprintf(File, ",\n{\"name\":\"%s\",\"cat\":\"csg\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                GetProfileStageName(Event.Stage), Event.ThreadId,
+                (Event.StartNs - GlobalProfiler.TraceStart) / 1e3, (Event.EndNs - Event.StartNs) / 1e3);
+    }
+    GlobalProfiler.TraceEvents.clear();
+    fflush(File);
+}
+
+// NOTE: the profiler stays enabled, the stats output may still use it
+void
+ProfilerStopTrace()
+{
+    if(!GlobalProfiler.IsTracing.exchange(false)) return;
+    ProfilerFlushTrace();
+
+    std::lock_guard<std::mutex> Lock(GlobalProfiler.TraceMutex);
+    fprintf(GlobalProfiler.TraceFile, "\n]\n");
+    fclose(GlobalProfiler.TraceFile);
+    GlobalProfiler.TraceFile = nullptr;
+}
@@ -0,0 +1,132 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// NOTE: stages can nest, time spent in an inner stage is also counted in the outer one.
+// All times are CPU times of the thread that ran the stage, so GL calls only count
+// the time the driver took to accept them. A stage run on another thread (the CSG
+// worker) is counted in the frame it ended in
+enum profile_stage
+{
+    profile_frame,
+    profile_tree_build,
+    profile_collision,
+    profile_subtract,
+    profile_generate_vertices,
+    profile_upload,
+    profile_draw,
+
+    profile_stage_count,
+};
+
+const uint32_t PROFILE_HISTORY_SIZE = 256;
+
+// NOTE: one finished stage for the trace. ThreadId is the small id of ProfilerGetThreadId
+struct profile_event
+{
+    uint64_t StartNs;
+    uint64_t EndNs;
+    uint32_t ThreadId;
+    profile_stage Stage;
+};
+
+// NOTE: FrameNs is the time of each stage in the current frame, added to from
+// any thread. At the end of a frame it moves into History, which keeps the
+// last PROFILE_HISTORY_SIZE frames of every stage
+struct profiler
+{
+    std::atomic<bool> IsEnabled = false;
+    std::atomic<uint64_t> FrameNs[profile_stage_count] = {};
+
+    uint64_t FrameStart = 0;
+    uint64_t History[profile_stage_count][PROFILE_HISTORY_SIZE] = {};
+    uint64_t FrameCount = 0;
+
+    // NOTE: while tracing, every stage is also kept as an event. Events are collected
+    // from all threads and written to TraceFile at the end of each frame, so a long
+    // session does not keep them in memory. Everything below IsTracing is guarded
+    // by TraceMutex
+    std::atomic<bool> IsTracing = false;
+    std::mutex TraceMutex;
+    std::vector<profile_event> TraceEvents;
+    std::vector<std::string> ThreadNames;
+    std::vector<bool> IsThreadNameWritten;
+    FILE* TraceFile = nullptr;
+    uint64_t TraceStart = 0;
+};
+
+struct profile_stats
+{
+    uint64_t P50Ns = 0;
+    uint64_t P99Ns = 0;
+    uint64_t MaxNs = 0;
+    uint32_t SampleCount = 0;
+};
+
+extern profiler GlobalProfiler;
+
+uint64_t ProfilerGetTime();
+
+// NOTE: disabling clears the history, so stats never mix two runs
+void ProfilerSetEnabled(bool Enabled);
+void ProfilerBeginFrame();
+void ProfilerEndFrame();
+
+const char* GetProfileStageName(profile_stage Stage);
+profile_stats ProfilerGetStats(profile_stage Stage);
+
+// NOTE: one line per stage with p50, p99 and max in ms. Returns the length of the text
+size_t ProfilerFormatStats(char* Buffer, size_t BufferSize);
+
+// NOTE: ids start at 1 in the order the threads first ask for one. The name is
+// shown for the thread in the trace viewer
+uint32_t ProfilerGetThreadId();
+void ProfilerSetThreadName(const char* Name);
+
+// NOTE: the trace is in the JSON array format of chrome://tracing, which Perfetto
+// also opens. Starting a trace enables the profiler. The closing bracket is
+// optional in this format, so the file of a session that did not stop still opens
+bool ProfilerStartTrace(const char* Path);
+void ProfilerFlushTrace();
+void ProfilerStopTrace();
+void ProfilerRecordEvent(profile_stage Stage, uint64_t StartNs, uint64_t EndNs);
+
+// NOTE: when the profiler is disabled this is one relaxed load and no clock read
+struct profile_scope
+{
+    profile_stage Stage;
+    uint64_t Start = 0;
+
+    profile_scope(profile_stage NewStage) : Stage(NewStage)
+    {
+        if(GlobalProfiler.IsEnabled.load(std::memory_order_relaxed)) Start = ProfilerGetTime();
+    }
+
+    ~profile_scope()
+    {
+        if(!Start) return;
+
+        uint64_t End = ProfilerGetTime();
+        GlobalProfiler.FrameNs[Stage].fetch_add(End - Start, std::memory_order_relaxed);
+        if(GlobalProfiler.IsTracing.load(std::memory_order_relaxed)) ProfilerRecordEvent(Stage, Start, End);
+    }
+};
+
+#define PROFILE_CONCAT_(A, B) A##B
+#define PROFILE_CONCAT(A, B) PROFILE_CONCAT_(A, B)
+
+// NOTE: building with CSG_NO_PROFILER removes the timers completely
+#ifdef CSG_NO_PROFILER
+#define PROFILE_SCOPE(Stage)
+#else
+#define PROFILE_SCOPE(Stage) profile_scope PROFILE_CONCAT(ProfileScope, __LINE__)(Stage)
+#endif
+
+#endif // PROFILER_H
@@ -0,0 +1,148 @@
+#include "taskpool.h"
+#include "profiler.h"
+
+#include <algorithm>
+#include <string>
+
+static thread_local task_pool* CurrentPool = nullptr;
+static thread_local uint32_t CurrentQueueIdx = 0;
+
+task_pool::
+task_pool(uint32_t ThreadCount)
+{
+    if(ThreadCount == 0)
+    {
+        ThreadCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+    }
+
+    for(uint32_t Idx = 0;
+        Idx < ThreadCount;
+        ++Idx)
+    {
+        Queues.push_back(std::make_unique<task_queue>());
+    }
+
+    for(uint32_t Idx = 0;
+        Idx < ThreadCount;
+        ++Idx)
+    {
+        Workers.emplace_back(&task_pool::WorkerLoop, this, Idx);
+    }
+}
+
+task_pool::
+~task_pool()
+{
+    {
+        std::unique_lock<std::mutex> Lock(SleepMutex);
+        IsRunning = false;
+    }
+    SleepCond.notify_all();
+
+    for(std::thread& Worker : Workers)
+    {
+        Worker.join();
+    }
+}
+
+task_pool& task_pool::
+Get()
+{
+    static task_pool Pool;
+    return Pool;
+}
+
+uint32_t task_pool::
+GetQueueIdx()
+{
+    if(CurrentPool == this) return CurrentQueueIdx;
+    return NextQueue.fetch_add(1, std::memory_order_relaxed) % Queues.size();
+}
+
+void task_pool::
+Submit(task_group& Group, std::function<void()> Func)
+{
+    Group.Pending.fetch_add(1, std::memory_order_relaxed);
+
+    task_queue& Queue = *Queues[GetQueueIdx()];
+    {
+        std::unique_lock<std::mutex> Lock(Queue.Mutex);
+        Queue.Tasks.push_back({std::move(Func), &Group});
+    }
+    QueuedCount.fetch_add(1, std::memory_order_release);
+
+    {
+        std::unique_lock<std::mutex> Lock(SleepMutex);
+    }
+    SleepCond.notify_one();
+}
+
+bool task_pool::
+TryRunOne(uint32_t QueueIdx)
+{
+    task Task = {};
+    bool IsFound = false;
+
+    {
+        task_queue& Queue = *Queues[QueueIdx];
+        std::unique_lock<std::mutex> Lock(Queue.Mutex);
+        if(!Queue.Tasks.empty())
+        {
+            Task = std::move(Queue.Tasks.back());
+            Queue.Tasks.pop_back();
+            IsFound = true;
+        }
+    }
+
+    for(uint32_t Offset = 1;
+        !IsFound && Offset < Queues.size();
+        ++Offset)
+    {
+        task_queue& Queue = *Queues[(QueueIdx + Offset) % Queues.size()];
+        std::unique_lock<std::mutex> Lock(Queue.Mutex);
+        if(!Queue.Tasks.empty())
+        {
+            Task = std::move(Queue.Tasks.front());
+            Queue.Tasks.pop_front();
+            IsFound = true;
+        }
+    }
+
+    if(!IsFound) return false;
+
+    QueuedCount.fetch_sub(1, std::memory_order_relaxed);
+    Task.Func();
+    Task.Group->Pending.fetch_sub(1, std::memory_order_release);
+
+    return true;
+}
+
+void task_pool::
+Wait(task_group& Group)
+{
+    uint32_t QueueIdx = (CurrentPool == this) ? CurrentQueueIdx : 0;
+    while(Group.Pending.load(std::memory_order_acquire) != 0)
+    {
+        if(!TryRunOne(QueueIdx))
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void task_pool::
+WorkerLoop(uint32_t QueueIdx)
+{
+    CurrentPool = this;
+    CurrentQueueIdx = QueueIdx;
+    ProfilerSetThreadName(("pool worker " + std::to_string(QueueIdx)).c_str());
+
+    while(true)
+    {
+        if(TryRunOne(QueueIdx)) continue;
+
+        std::unique_lock<std::mutex> Lock(SleepMutex);
+        SleepCond.wait(Lock, [this]() { return !IsRunning || (QueuedCount.load(std::memory_order_acquire) != 0); });
+        if(!IsRunning && (QueuedCount.load(std::memory_order_acquire) == 0)) return;
+    }
+}
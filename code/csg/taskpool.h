@@ -0,0 +1,63 @@
+#ifndef TASKPOOL_H
+#define TASKPOOL_H
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <deque>
+#include <vector>
+#include <functional>
+#include <memory>
+
+// NOTE: tasks submitted with the same group are waited together
+struct task_group
+{
+    std::atomic<uint32_t> Pending = 0;
+};
+
+// NOTE: every worker owns a queue. It takes its own work from the back
+// and steals from the front of the other queues when it runs out.
+// Waiting threads (including non-workers) help executing tasks, so
+// tasks can submit and wait for other tasks without a deadlock
+class task_pool
+{
+public:
+    task_pool(uint32_t ThreadCount = 0);
+    ~task_pool();
+
+    void Submit(task_group& Group, std::function<void()> Func);
+    void Wait(task_group& Group);
+
+    uint32_t GetThreadCount() const { return Workers.size(); }
+
+    static task_pool& Get();
+
+private:
+    struct task
+    {
+        std::function<void()> Func;
+        task_group* Group;
+    };
+
+    struct task_queue
+    {
+        std::mutex Mutex;
+        std::deque<task> Tasks;
+    };
+
+    bool TryRunOne(uint32_t QueueIdx);
+    void WorkerLoop(uint32_t QueueIdx);
+    uint32_t GetQueueIdx();
+
+    std::vector<std::unique_ptr<task_queue>> Queues;
+    std::vector<std::thread> Workers;
+
+    std::mutex SleepMutex;
+    std::condition_variable SleepCond;
+    std::atomic<uint32_t> QueuedCount = 0;
+    std::atomic<uint32_t> NextQueue = 0;
+    bool IsRunning = true;
+};
+
+#endif // TASKPOOL_H
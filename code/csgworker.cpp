@@ -0,0 +1,314 @@
+#include "csgworker.h"
+
+#include <cstring>
+
+csg_worker::
+csg_worker()
+{
+    Thread = std::thread(&csg_worker::WorkerLoop, this);
+}
+
+csg_worker::
+~csg_worker()
+{
+    {
+        std::unique_lock<std::mutex> Lock(Mutex);
+        IsRunning = false;
+    }
+    Cond.notify_one();
+    Thread.join();
+}
+
+// NOTE: true if the tool goes on along the same line in the same direction at Via,
+// then the path does not need Via. A step that stays in place does not need it either
+static bool
+IsStraightThrough(const mat4& From, const mat4& Via, const mat4& To)
+{
+    vec3 First = vec3(0);
+    vec3 Second = vec3(0);
+    if(!IsTranslationOf(From, Via, First) || !IsTranslationOf(Via, To, Second)) return false;
+
+    float FirstLengthSq = First.LengthSq();
+    float SecondLengthSq = Second.LengthSq();
+    if((FirstLengthSq == 0) || (SecondLengthSq == 0)) return true;
+
+    vec3 Turn = Cross(First, Second);
+    return (First.Dot(Second) > 0) && (Turn.LengthSq() <= 1e-10f * FirstLengthSq * SecondLengthSq);
+}
+
+uint64_t csg_worker::
+Submit(csg_job Job)
+{
+    uint64_t JobId;
+    {
+        std::unique_lock<std::mutex> Lock(Mutex);
+        if(PendingJob)
+        {
+            // NOTE: the newer job has the newer poses, but a mesh that only
+            // the older one carried is still needed. The path of both steps
+            // starts where the older one started and goes through the pose it ended at.
+            // If the older one was the first, the path starts at its pose
+            if(!Job.Stock) Job.Stock = std::move(PendingJob->Stock);
+            if(!Job.Tool)  Job.Tool  = std::move(PendingJob->Tool);
+            Job.ToolWaypoints.clear();
+            if(PendingJob->ToolFromModel)
+            {
+                Job.ToolFromModel = PendingJob->ToolFromModel;
+                Job.ToolWaypoints = std::move(PendingJob->ToolWaypoints);
+
+                mat4 Previous = Job.ToolWaypoints.empty() ? *Job.ToolFromModel : Job.ToolWaypoints.back();
+                if(!IsStraightThrough(Previous, PendingJob->ToolModel, Job.ToolModel))
+                    Job.ToolWaypoints.push_back(PendingJob->ToolModel);
+            }
+            else
+            {
+                Job.ToolFromModel = PendingJob->ToolModel;
+            }
+            CoalescedCount++;
+        }
+        PendingJob = std::move(Job);
+        JobId = PendingJobId = NextJobId++;
+    }
+    Cond.notify_one();
+
+    return JobId;
+}
+
+std::shared_ptr<const csg_frame> csg_worker::
+GetLatestFrame()
+{
+    std::unique_lock<std::mutex> Lock(Mutex);
+    return LatestFrame;
+}
+
+uint64_t csg_worker::
+GetCoalescedCount()
+{
+    std::unique_lock<std::mutex> Lock(Mutex);
+    return CoalescedCount;
+}
+
+void csg_worker::
+WorkerLoop()
+{
+    ProfilerSetThreadName("csg worker");
+
+    while(true)
+    {
+        csg_job Job;
+        uint64_t JobId;
+        {
+            std::unique_lock<std::mutex> Lock(Mutex);
+            Cond.wait(Lock, [this]() { return !IsRunning || PendingJob.has_value(); });
+            if(!IsRunning) return;
+
+            Job = std::move(*PendingJob);
+            JobId = PendingJobId;
+            PendingJob.reset();
+        }
+
+        RunJob(Job, JobId);
+    }
+}
+
+// NOTE: one check per motion step of the tool, from the pose of the last check to the
+// current one. A step that only moves the tool is swept, so a step longer than the
+// stock or the tool can not pass through it between two checks. ToolSweep.Time is
+// the part of the step done before the first contact when GJK gives it for free,
+// otherwise it is 0. The cut always takes the whole step, so nothing narrows it down.
+// Steps that also rotate or scale are checked at the end pose only
+bool csg_worker::
+CheckToolStep(mat4 From)
+{
+    PROFILE_SCOPE(profile_collision);
+
+    ToolSweep = {};
+
+    vec3 Translation = vec3(0);
+    bool IsSwept = IsTranslationOf(From, Cylinder.Model, Translation) && (Translation.LengthSq() > 0);
+
+    aabb ToolBounds = Cylinder.GetAABB();
+    if(IsSwept)
+    {
+        aabb StartBounds = ToolBounds;
+        StartBounds.Min -= Translation;
+        StartBounds.Max -= Translation;
+        ToolBounds = AABBUnion(StartBounds, ToolBounds);
+    }
+    if(!AABBOverlap(CubeStock.Bounds[0], ToolBounds)) return false;
+
+    if(CubeStock.CutCount == 0)
+        UpdateConvexShape(CubeShape, Cube);
+    UpdateConvexShape(CylinderShape, Cylinder);
+
+    // NOTE: while the stock is uncut and both meshes are convex, GJK decides on its own
+    if(CubeStock.CutCount == 0 && CubeShape.IsConvex && CylinderShape.IsConvex)
+    {
+        if(IsSwept)
+        {
+            ToolSweep = GJKSweep(CubeShape, Cube.Model, CylinderShape, From, Translation, ToolCache);
+            return ToolSweep.IsHit;
+        }
+
+        ToolContact = GJKCollide(CubeShape, Cube.Model, CylinderShape, Cylinder.Model, ToolCache);
+        ToolSweep.IsHit = ToolContact.IsColliding;
+        ToolSweep.Time = 0;
+        return ToolSweep.IsHit;
+    }
+
+    // NOTE: crossing triangles prove contact. Without them the surfaces are apart, so
+    // either one solid is all inside of the other or they do not touch, and a vertex
+    // of each against the tree of the other decides. Only vertices in the bounds of
+    // the other solid are tested, a stock cut into pieces has a vertex in each of them.
+    // Generated vertices are in world space
+    UpdateBSPStockBVH(CubeStock);
+    if(!IsSwept || !CylinderShape.IsConvex)
+    {
+        UpdateBVH(CylinderBVH, Cylinder, Cylinder.Model);
+        ToolSweep.IsHit = BVHIntersect(CubeStock.BVH, CylinderBVH) ||
+                          BSPIsAnyVertexInside(CubeStock.Tree, CylinderCache.Generated, CubeStock.Bounds[0]) ||
+                          BSPStockIsAnyVertexInside(CylinderCache.Tree, CubeStock, Cylinder.GetAABB());
+        ToolSweep.Time = 0;
+        return ToolSweep.IsHit;
+    }
+
+    // NOTE: the swept solid of the whole step decides
+    UpdateToolSwept(From, Translation);
+    ToolSweep.IsHit = BSPStockSweepIntersect(CubeStock, ToolSwept, ToolSweptBVH);
+    ToolSweep.Time = 0;
+    return ToolSweep.IsHit;
+}
+
+void csg_worker::
+UpdateToolSwept(mat4 From, vec3 Translation)
+{
+    if(HasToolSwept && (ToolSweptVersion == CylinderShape.GeometryVersion) &&
+       (memcmp(ToolSweptFrom.V, From.V, sizeof(From.V)) == 0) &&
+       (ToolSweptTranslation.x == Translation.x) && (ToolSweptTranslation.y == Translation.y) &&
+       (ToolSweptTranslation.z == Translation.z))
+        return;
+
+    SweepConvexShape(CylinderShape, From, Translation, vec3(0.8, 0.25, 0.35), ToolSwept);
+    ToolSweptFrom = From;
+    ToolSweptTranslation = Translation;
+    ToolSweptVersion = CylinderShape.GeometryVersion;
+    HasToolSwept = true;
+}
+
+// NOTE: checks the step of the tool from From to where it is now, and cuts what it went
+// through if it reached the stock. Returns true if it did
+bool csg_worker::
+RunToolStep(mat4 From, const bsp_build_params& Params, const bsp_build_params& ToolParams)
+{
+    if(CubeStock.Tree.Nodes.empty() || !CheckToolStep(From)) return false;
+
+    Cube.UpdateColor(vec3(0.25, 0.7, 0.35));
+    Cylinder.UpdateColor(vec3(0.8, 0.25, 0.35));
+
+    // NOTE: the stock and the tool tree have to have the new colors before the cut,
+    // a stock rebuilt later would lose it
+    UpdateBSPStock(CubeStock, Cube, Params);
+    UpdateBSPCache(CylinderCache, Cylinder, ToolParams);
+
+    // NOTE: a step that only moved the tool removes everything the tool went through
+    // with one cut of the swept solid, instead of a cut at the end pose that would
+    // leave the material between two steps. A swept solid with more planes than
+    // the depth limit would lose the last of them and cut the wrong material,
+    // the cut at the end pose is taken instead.
+    // On a cut stock the check already built the swept solid, only the GJK check did not.
+    // A tool that is not convex can only be cut at the end pose, and BSPStockSubtract
+    // builds the stock again for it instead of cutting in place
+    bool IsSweptCut = false;
+    vec3 Translation = vec3(0);
+    if(CylinderShape.IsConvex && IsTranslationOf(From, Cylinder.Model, Translation) &&
+       (Translation.LengthSq() > 0))
+    {
+        csg_stats SweptStats;
+        UpdateToolSwept(From, Translation);
+        UpdateBSPCache(ToolSweptCache, ToolSwept, ToolParams, &SweptStats);
+        IsSweptCut = SweptStats.DepthCapHits == 0;
+    }
+
+    if(IsSweptCut)
+        BSPStockSubtract(CubeStock, ToolSweptCache.Tree, ToolParams);
+    else
+        BSPStockSubtract(CubeStock, CylinderCache.Tree, ToolParams);
+
+    return true;
+}
+
+void csg_worker::
+RunJob(csg_job& Job, uint64_t JobId)
+{
+    // NOTE: a new mesh gets a version above the one it replaces, so that caches
+    // built from the old mesh can not take it for the same geometry
+    if(Job.Stock)
+    {
+        uint64_t Version = Cube.GeometryVersion + 1;
+        Cube = std::move(*Job.Stock);
+        Cube.GeometryVersion = Version;
+    }
+    if(Job.Tool)
+    {
+        uint64_t Version = Cylinder.GeometryVersion + 1;
+        Cylinder = std::move(*Job.Tool);
+        Cylinder.GeometryVersion = Version;
+    }
+    Cube.Model = Job.StockModel;
+
+    bsp_build_params ToolParams = Job.Params;
+    ToolParams.MaxDepth = CSG_TOOL_MAX_DEPTH;
+
+    // NOTE: trees are rebuilt only when geometry of the mesh changed,
+    // a new transform just moves the cached tree.
+    // Cube is the source of the stock, cuts go into CubeStock and not back into Cube
+    bool CubeWasChanged = UpdateBSPStock(CubeStock, Cube, Job.Params);
+
+    // NOTE: the tool goes along its path one step at a time, each step is checked and
+    // cut on its own. If nothing changed in a step, then the result of the last check
+    // still holds. A moved tool is checked over the whole step and not only at where it is now
+    bool WasCollided = false;
+    bool CylinderWasChanged = false;
+    mat4 ToolFrom = Job.ToolFromModel.value_or(Job.ToolModel);
+    for(size_t Step = 0;
+        Step <= Job.ToolWaypoints.size();
+        ++Step)
+    {
+        Cylinder.Model = (Step < Job.ToolWaypoints.size()) ? Job.ToolWaypoints[Step] : Job.ToolModel;
+        bool WasMoved = UpdateBSPCache(CylinderCache, Cylinder, ToolParams);
+        if(CubeWasChanged || WasMoved)
+            WasCollided |= RunToolStep(ToolFrom, Job.Params, ToolParams);
+
+        CylinderWasChanged |= WasMoved;
+        CubeWasChanged = false;
+        ToolFrom = Cylinder.Model;
+    }
+
+    if(!WasCollided)
+    {
+        Cube.UpdateColor(vec3(0.25, 0.7, 0.35));
+        Cylinder.UpdateColor(vec3(0.25, 0.7, 0.35));
+        CylinderWasChanged |= UpdateBSPCache(CylinderCache, Cylinder, ToolParams);
+    }
+
+    // NOTE: the meshes to draw are copied only when they changed, the frame before
+    // may still be drawn from. The tool is not drawn while it cuts
+    if(!StockDrawn || (CubeStock.Generated.GeometryVersion != StockDrawnVersion))
+    {
+        StockDrawn = std::make_shared<const mesh>(CubeStock.Generated);
+        StockDrawnVersion = CubeStock.Generated.GeometryVersion;
+    }
+    if(WasCollided)
+        ToolDrawn.reset();
+    else if(!ToolDrawn || CylinderWasChanged)
+        ToolDrawn = std::make_shared<const mesh>(CylinderCache.Generated);
+
+    std::shared_ptr<csg_frame> Frame = std::make_shared<csg_frame>();
+    Frame->Stock = StockDrawn;
+    Frame->Tool = ToolDrawn;
+    Frame->IsColliding = WasCollided;
+    Frame->JobId = JobId;
+
+    std::unique_lock<std::mutex> Lock(Mutex);
+    LatestFrame = std::move(Frame);
+}
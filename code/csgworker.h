@@ -0,0 +1,117 @@
+#ifndef CSGWORKER_H
+#define CSGWORKER_H
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "csg.h"
+
+// NOTE: depth limit of the trees made of tool planes: the tool, its swept solid and the
+// subtrees a cut adds to the stock. These are chains with one node per plane, so the
+// limit is their plane count. BuildBSPNode takes about 1.5 KB of stack per level, which
+// keeps this within the smallest default stack of a thread
+const uint32_t CSG_TOOL_MAX_DEPTH = 256;
+
+// NOTE: inputs of one CSG step. Models are sent every time, a mesh only when its
+// geometry changed since the last job, the worker keeps the one it got before.
+// ToolFromModel is the pose the tool moves from in this step, there is none for the first one.
+// ToolWaypoints are the poses the tool went through between ToolFromModel and ToolModel,
+// oldest first. The worker fills them when it merges jobs
+struct csg_job
+{
+    mat4 StockModel;
+    mat4 ToolModel;
+    std::optional<mat4> ToolFromModel;
+    std::vector<mat4> ToolWaypoints;
+    std::optional<mesh> Stock;
+    std::optional<mesh> Tool;
+    bsp_build_params Params;
+};
+
+// NOTE: result of one step, the meshes are in world space. A mesh that did not
+// change is the same object as in the frame before, so a reader can compare the pointers
+struct csg_frame
+{
+    std::shared_ptr<const mesh> Stock;
+    std::shared_ptr<const mesh> Tool;
+    bool IsColliding = false;
+    uint64_t JobId = 0;
+};
+
+// NOTE: runs the collision check and the cut of the tool on its own thread, so that the
+// GUI thread only submits the poses and draws the last finished frame.
+// There is at most one job waiting, a new job replaces it. The new job then moves the
+// tool from where the replaced one started and through the pose it ended at, so the
+// tool is still swept along the path it took. A pose on the straight line between
+// the ones around it is left out of the path, it would only split one cut in two
+class csg_worker
+{
+public:
+    csg_worker();
+    ~csg_worker();
+
+    csg_worker(const csg_worker&) = delete;
+    csg_worker& operator=(const csg_worker&) = delete;
+
+    // NOTE: returns the id of the job, ids grow by one with every submit
+    uint64_t Submit(csg_job Job);
+
+    // NOTE: null until the first job is done
+    std::shared_ptr<const csg_frame> GetLatestFrame();
+
+    // NOTE: number of jobs that were replaced by a newer one before they started
+    uint64_t GetCoalescedCount();
+
+private:
+    void WorkerLoop();
+    void RunJob(csg_job& Job, uint64_t JobId);
+    bool RunToolStep(mat4 From, const bsp_build_params& Params, const bsp_build_params& ToolParams);
+    bool CheckToolStep(mat4 From);
+    void UpdateToolSwept(mat4 From, vec3 Translation);
+
+    std::thread Thread;
+    std::mutex Mutex;
+    std::condition_variable Cond;
+    bool IsRunning = true;
+    std::optional<csg_job> PendingJob;
+    uint64_t PendingJobId = 0;
+    uint64_t NextJobId = 1;
+    uint64_t CoalescedCount = 0;
+    std::shared_ptr<const csg_frame> LatestFrame;
+
+    // NOTE: everything below is only touched by the worker thread
+    mesh Cube;
+    mesh Cylinder;
+
+    bsp_stock CubeStock;
+    bsp_cache CylinderCache;
+
+    bvh CylinderBVH;
+
+    convex_shape CubeShape;
+    convex_shape CylinderShape;
+    gjk_cache ToolCache;
+    convex_contact ToolContact;
+
+    // NOTE: ToolSwept is the solid of the tool moving from ToolSweptFrom by ToolSweptTranslation.
+    // It is kept while they and the tool geometry stay the same, so the check and the cut
+    // of a step share it, and its bvh and tree are not rebuilt
+    convex_sweep ToolSweep;
+    mesh ToolSwept;
+    bvh ToolSweptBVH;
+    bsp_cache ToolSweptCache;
+    mat4 ToolSweptFrom = {};
+    vec3 ToolSweptTranslation = vec3(0);
+    uint64_t ToolSweptVersion = 0;
+    bool HasToolSwept = false;
+
+    std::shared_ptr<const mesh> StockDrawn;
+    std::shared_ptr<const mesh> ToolDrawn;
+    uint64_t StockDrawnVersion = ~0ull;
+};
+
+#endif // CSGWORKER_H
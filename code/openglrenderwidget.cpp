@@ -100,854 +100,6 @@ void APIENTRY OpenGLRenderWidget::GLDebugMessageCallback(GLenum source, GLenum t
            id, _type.c_str(), _severity.c_str(), _source.c_str(), msg);
 }
 
-vec4
-GetPlaneFromPolygon(const polygon &Polygon)
-{
-    vec4 Plane = {};
-
-    vec4 v0 = Polygon.V[0].Pos;
-    vec4 v1 = Polygon.V[1].Pos;
-    vec4 v2 = Polygon.V[2].Pos;
-
-    vec3 A = v0.xyz;
-    vec3 B = v1.xyz;
-    vec3 C = v2.xyz;
-
-    vec3 AB = B - A;
-    vec3 AC = C - A;
-    vec3 Normal = Cross(AB, AC).Normalize();
-
-    Plane.xyz = Normal;
-    Plane.w = Normal.Dot(A);
-
-    return Plane;
-}
-
-uint32_t
-ClassifyPointToPlane(vec3 P, vec4 Plane)
-{
-    vec3 Normal = Plane.xyz;
-    float Dist = Normal.Dot(P) - Plane.w;
-    float PlaneThickness = std::numeric_limits<float>::epsilon();
-
-    if(Dist >  PlaneThickness)
-        return POINT_IN_FRONT_OF_PLANE;
-    if(Dist < -PlaneThickness)
-        return POINT_BEHIND_PLANE;
-    return POINT_ON_PLANE;
-}
-
-uint32_t
-ClassifyPolygonToPlane(const polygon &Polygon, vec4 Plane)
-{
-    uint32_t NumInFront = 0, NumBehind = 0;
-    for(uint32_t PointIdx = 0;
-        PointIdx < 3;
-        ++PointIdx)
-    {
-        vec4 PolygonPos = Polygon[PointIdx].Pos;
-        switch(ClassifyPointToPlane(PolygonPos.xyz, Plane))
-        {
-            case POINT_IN_FRONT_OF_PLANE:
-            {
-                NumInFront++;
-            } break;
-            case POINT_BEHIND_PLANE:
-            {
-                NumBehind++;
-            } break;
-        }
-    }
-
-    if(NumBehind  != 0 && NumInFront != 0) return POLYGON_STRADDLING_PLANE;
-    if(NumInFront != 0) return POLYGON_IN_FRONT_OF_PLANE;
-    if(NumBehind  != 0) return POLYGON_BEHIND_PLANE;
-    return POLYGON_COPLANAR_WITH_PLANE;
-}
-
-vec4
-PickSplitingPlane(const std::vector<polygon>& Polygons)
-{
-    vec4 BestPlane = {};
-    float BestScore = std::numeric_limits<float>::max();
-    const float BlendFactor = 0.8f;
-
-    for(uint32_t i = 0;
-        i < Polygons.size();
-        i++)
-    {
-        int NumInFront = 0, NumBehind = 0, NumStraddling = 0;
-        vec4 Plane = GetPlaneFromPolygon(Polygons[i]);
-
-        for(uint32_t j = 0;
-            j < Polygons.size();
-            j++)
-        {
-            if(i == j) continue;
-
-            switch(ClassifyPolygonToPlane(Polygons[j], Plane))
-            {
-                case POLYGON_COPLANAR_WITH_PLANE: // NOTE: Coplanar with the plane
-                {
-                    NumInFront++;
-                } break;
-                case POLYGON_IN_FRONT_OF_PLANE: // NOTE: In front of the plane
-                {
-                    NumInFront++;
-                } break;
-                case POLYGON_BEHIND_PLANE: // NOTE: Behind of the plane
-                {
-                    NumBehind++;
-                } break;
-                case POLYGON_STRADDLING_PLANE: // NOTE: Straddling plane
-                {
-                    NumStraddling++;
-                } break;
-            }
-
-            float Score = BlendFactor * NumStraddling + (1.0f - BlendFactor) * abs(NumInFront - NumBehind);
-            if(Score < BestScore)
-            {
-                BestScore = Score;
-                BestPlane = Plane;
-            }
-        }
-    }
-
-    return BestPlane;
-}
-
-bool BSPCollision(const std::unique_ptr<bsp_node>& Tree, const std::vector<polygon>& Polygons)
-{
-    bool Res = false;
-
-    vec4 Plane = Tree->Plane;
-    for(uint32_t Idx = 0;
-        Idx < Polygons.size();
-        ++Idx)
-    {
-        polygon Poly = Polygons[Idx];
-        uint32_t CollisionCls = ClassifyPolygonToPlane(Poly, Plane);
-        Res |= (CollisionCls == POLYGON_STRADDLING_PLANE) || (CollisionCls == POLYGON_BEHIND_PLANE);
-    }
-
-    if(Tree->Front)
-        Res &= BSPCollision(Tree->Front, Polygons);
-    if(Tree->Back)
-        Res &= BSPCollision(Tree->Back, Polygons);
-
-    return Res;
-}
-
-bool BSPCollision(const std::unique_ptr<bsp_node>& Tree, mesh& Mesh)
-{
-    bool Res = false;
-    std::vector<polygon> Polygons = Mesh.GeneratePolygons(Mesh.VertexIndices);
-
-    vec4 Plane = Tree->Plane;
-    for(uint32_t Idx = 0;
-        Idx < Polygons.size();
-        ++Idx)
-    {
-        polygon Poly = Polygons[Idx];
-        uint32_t CollisionCls = ClassifyPolygonToPlane(Poly, Plane);
-        Res |= (CollisionCls == POLYGON_STRADDLING_PLANE) || (CollisionCls == POLYGON_BEHIND_PLANE);
-    }
-
-    if(Tree->Front)
-        Res &= BSPCollision(Tree->Front, Polygons);
-    if(Tree->Back)
-        Res &= BSPCollision(Tree->Back, Polygons);
-
-    return Res;
-}
-
-bool IsConvex(std::vector<vec3> Shape)
-{
-    bool Sign = false;
-    vec3 A, B, C;
-    for(int Idx = 0;
-        Idx < Shape.size();
-        ++Idx)
-    {
-        A = Shape[Idx];
-        B = Shape[(Idx + 1) % Shape.size()];
-        C = Shape[(Idx + 2) % Shape.size()];
-
-        float ZCross = Cross(C - B, A - B).z;
-        if(Idx == 0)
-            Sign = ZCross > 0.0;
-        else if(Sign != (ZCross > 0.0))
-            return false;
-
-    }
-    return true;
-}
-
-bool AreCollided(mesh& A, mesh& B)
-{
-    std::vector<vec3> ShapeA = A.GenerateShape(A.VertexIndices);
-    std::vector<vec3> ShapeB = B.GenerateShape(B.VertexIndices);
-    if(IsConvex(ShapeA))
-    {
-        qDebug("A is convex");
-    }
-    if(IsConvex(ShapeB))
-    {
-        qDebug("B is convex");
-    }
-    return false;
-}
-
-vec3
-EdgePlaneIntersection(vec3 A, vec3 B, vec4 Plane)
-{
-    vec3 Result = {};
-    vec3 AB = B - A;
-    vec3 Normal = Plane.xyz;
-    float t = (Plane.w - Normal.Dot(A)) / Normal.Dot(AB);
-    Result = A + AB * t;
-
-    return Result;
-}
-
-void
-SplitPolygon(const polygon& Poly, vec4 SplitPlane, std::vector<polygon>& FrontPolygons, std::vector<polygon>& BackPolygons)
-{
-    // TODO: move this to vertex struct so that
-    // I could propagate normals to correct place
-    std::vector<vec3> FrontVerts;
-    std::vector<vec3> BackVerts;
-
-    vec4 TempPrev = Poly.V[2].Pos;
-    vec3 Prev = TempPrev.xyz;
-    uint32_t PrevSide = ClassifyPointToPlane(Prev, SplitPlane);
-    for(int VertIdx = 0;
-        VertIdx < 3;
-        ++VertIdx)
-    {
-        vec4 TempCurr = Poly.V[VertIdx].Pos;
-        vec3 Curr = TempCurr.xyz;
-        uint32_t CurrSide = ClassifyPointToPlane(Curr, SplitPlane);
-        if(CurrSide == POINT_IN_FRONT_OF_PLANE)
-        {
-            if(PrevSide == POINT_BEHIND_PLANE)
-            {
-                vec3 I = EdgePlaneIntersection(Curr, Prev, SplitPlane);
-                //assert(ClassifyPointToPlane(I, SplitPlane) == POINT_ON_PLANE);
-                BackVerts.push_back(I);
-                FrontVerts.push_back(I);
-            }
-            FrontVerts.push_back(Curr);
-        }
-        else if(CurrSide == POINT_BEHIND_PLANE)
-        {
-            if(PrevSide == POINT_IN_FRONT_OF_PLANE)
-            {
-                vec3 I = EdgePlaneIntersection(Prev, Curr, SplitPlane);
-                //assert(ClassifyPointToPlane(I, SplitPlane) == POINT_ON_PLANE);
-                FrontVerts.push_back(I);
-                BackVerts.push_back(I);
-            }
-            else if(PrevSide == POINT_ON_PLANE)
-            {
-                BackVerts.push_back(Prev);
-            }
-            BackVerts.push_back(Curr);
-        }
-        else  if(CurrSide == POINT_ON_PLANE)
-        {
-            FrontVerts.push_back(Curr);
-            if(PrevSide == POINT_BEHIND_PLANE)
-            {
-                BackVerts.push_back(Curr);
-            }
-
-        }
-        Prev = Curr;
-        PrevSide = CurrSide;
-    }
-
-    if(FrontVerts.size() == 3)
-    {
-        vec3 v0 = *std::next(FrontVerts.begin(), 0);
-        vec3 v1 = *std::next(FrontVerts.begin(), 1);
-        vec3 v2 = *std::next(FrontVerts.begin(), 2);
-        polygon NewPolygon(v0, v1, v2, Poly[0].Norm, Poly[0].Col);
-        FrontPolygons.push_back(NewPolygon);
-    }
-    else if(FrontVerts.size() == 4)
-    {
-        vec3 v0 = *std::next(FrontVerts.begin(), 0);
-        vec3 v1 = *std::next(FrontVerts.begin(), 1);
-        vec3 v2 = *std::next(FrontVerts.begin(), 2);
-        vec3 v3 = *std::next(FrontVerts.begin(), 3);
-
-        polygon NewPolygon1(v0, v1, v2, Poly[0].Norm, Poly[0].Col);
-        FrontPolygons.push_back(NewPolygon1);
-
-        polygon NewPolygon2(v0, v2, v3, Poly[0].Norm, Poly[0].Col);
-        FrontPolygons.push_back(NewPolygon2);
-    }
-
-    if(BackVerts.size() == 3)
-    {
-        vec3 v0 = *std::next(BackVerts.begin(), 0);
-        vec3 v1 = *std::next(BackVerts.begin(), 1);
-        vec3 v2 = *std::next(BackVerts.begin(), 2);
-        polygon NewPolygon(v0, v1, v2, Poly[0].Norm, Poly[0].Col);
-        BackPolygons.push_back(NewPolygon);
-    }
-    else if(BackVerts.size() == 4)
-    {
-        vec3 v0 = *std::next(BackVerts.begin(), 0);
-        vec3 v1 = *std::next(BackVerts.begin(), 1);
-        vec3 v2 = *std::next(BackVerts.begin(), 2);
-        vec3 v3 = *std::next(BackVerts.begin(), 3);
-
-        polygon NewPolygon1(v0, v1, v2, Poly[0].Norm, Poly[0].Col);
-        BackPolygons.push_back(NewPolygon1);
-
-        polygon NewPolygon2(v0, v2, v3, Poly[0].Norm, Poly[0].Col);
-        BackPolygons.push_back(NewPolygon2);
-    }
-}
-
-
-std::unique_ptr<bsp_node>
-BuildBSPTree(const std::vector<polygon>& Polygons, uint32_t Depth = 0)
-{
-    if(Polygons.size() == 0) return nullptr;
-
-    std::unique_ptr<bsp_node> NewNode(new bsp_node);
-    if(Depth >= 25)
-    {
-        NewNode->Polygons = Polygons;
-        return NewNode;
-    }
-
-    std::vector<polygon> Front, Back;
-
-    vec4 SplitPlane = PickSplitingPlane(Polygons);
-
-    for(uint32_t i = 0;
-        i < Polygons.size();
-        i++)
-    {
-        switch(ClassifyPolygonToPlane(Polygons[i], SplitPlane))
-        {
-            case POLYGON_COPLANAR_WITH_PLANE:
-            {
-                NewNode->Polygons.push_back(Polygons[i]);
-            } break;
-            case POLYGON_IN_FRONT_OF_PLANE:
-            {
-                Front.push_back(Polygons[i]);
-            } break;
-            case POLYGON_BEHIND_PLANE:
-            {
-                Back.push_back(Polygons[i]);
-            } break;
-            case POLYGON_STRADDLING_PLANE:
-            {
-                SplitPolygon(Polygons[i], SplitPlane, Front, Back);
-            } break;
-        }
-    }
-
-    NewNode->Plane = SplitPlane;
-    NewNode->Front = BuildBSPTree(Front, Depth + 1);
-    NewNode->Back  = BuildBSPTree(Back, Depth + 1);
-
-    return NewNode;
-}
-
-void BSPInsert(std::unique_ptr<bsp_node>& Tree, const std::vector<polygon>& Polygons)
-{
-    if(Polygons.size() == 0) return;
-    if(!Tree) return;
-
-    vec4 SplitPlane = Tree->Plane;
-    std::vector<polygon> Front, Back;
-
-    for(uint32_t i = 0;
-        i < Polygons.size();
-        i++)
-    {
-        polygon Polygon = Polygons[i];
-
-        switch(ClassifyPolygonToPlane(Polygon, SplitPlane))
-        {
-            case POLYGON_COPLANAR_WITH_PLANE:
-            {
-                Tree->Polygons.push_back(Polygon);
-            }break;
-            case POLYGON_IN_FRONT_OF_PLANE:
-            {
-                Front.push_back(Polygon);
-            } break;
-            case POLYGON_BEHIND_PLANE:
-            {
-                Back.push_back(Polygon);
-            } break;
-            case POLYGON_STRADDLING_PLANE:
-            {
-                SplitPolygon(Polygon, SplitPlane, Front, Back);
-            } break;
-        }
-    }
-
-    if(!Tree->Front && (Front.size() != 0))
-        Tree->Front = std::make_unique<bsp_node>();
-    if(!Tree->Back  && (Back.size() != 0))
-        Tree->Back  = std::make_unique<bsp_node>();
-
-    if(Tree->Front)
-        BSPInsert(Tree->Front, Front);
-    if(Tree->Back)
-        BSPInsert(Tree->Back, Back);
-}
-
-void BSPInsertInner(std::unique_ptr<bsp_node>& Tree, const std::vector<polygon>& Polygons)
-{
-    if(Polygons.size() == 0) return;
-    if(!Tree) return;
-
-    vec4 SplitPlane = Tree->Plane;
-    std::vector<polygon> Front, Back;
-
-    for(uint32_t i = 0;
-        i < Polygons.size();
-        i++)
-    {
-        polygon Polygon = Polygons[i];
-
-        switch(ClassifyPolygonToPlane(Polygon, SplitPlane))
-        {
-            case POLYGON_COPLANAR_WITH_PLANE:
-            {
-                Tree->Polygons.push_back(Polygon);
-            }break;
-            case POLYGON_BEHIND_PLANE:
-            {
-                Back.push_back(Polygon);
-            } break;
-            case POLYGON_STRADDLING_PLANE:
-            {
-                SplitPolygon(Polygon, SplitPlane, Front, Back);
-            } break;
-        }
-    }
-
-    if(!Tree->Front && (Front.size() != 0))
-        Tree->Front = std::make_unique<bsp_node>();
-    if(!Tree->Back  && (Back.size() != 0))
-        Tree->Back  = std::make_unique<bsp_node>();
-
-    if(Tree->Front)
-        BSPInsertInner(Tree->Front, Front);
-    if(Tree->Back)
-        BSPInsertInner(Tree->Back, Back);
-}
-
-void BSPInsertOuter(std::unique_ptr<bsp_node>& Tree, const std::vector<polygon>& Polygons)
-{
-    if(Polygons.size() == 0) return;
-    if(!Tree) return;
-
-    vec4 SplitPlane = Tree->Plane;
-    std::vector<polygon> Front, Back;
-
-    for(uint32_t i = 0;
-        i < Polygons.size();
-        i++)
-    {
-        polygon Polygon = Polygons[i];
-
-        switch(ClassifyPolygonToPlane(Polygon, SplitPlane))
-        {
-            case POLYGON_COPLANAR_WITH_PLANE:
-            {
-                Tree->Polygons.push_back(Polygon);
-            }break;
-            case POLYGON_IN_FRONT_OF_PLANE:
-            {
-                Front.push_back(Polygon);
-            } break;
-            case POLYGON_STRADDLING_PLANE:
-            {
-                SplitPolygon(Polygon, SplitPlane, Front, Back);
-            } break;
-        }
-    }
-
-    if(!Tree->Front && (Front.size() != 0))
-        Tree->Front = std::make_unique<bsp_node>();
-    if(!Tree->Back  && (Back.size() != 0))
-        Tree->Back  = std::make_unique<bsp_node>();
-
-    if(Tree->Front)
-        BSPInsertOuter(Tree->Front, Front);
-    if(Tree->Back)
-        BSPInsertOuter(Tree->Back, Back);
-}
-
-std::optional<std::vector<polygon>>
-BSPInsertCreateBack1(std::unique_ptr<bsp_node>& Tree, const std::vector<polygon>& Polygons)
-{
-    if(Polygons.size() == 0) return {};
-    if(!Tree) return {};
-
-    vec4 SplitPlane = Tree->Plane;
-    std::vector<polygon> Front, Back, Result;
-
-    for(uint32_t i = 0;
-        i < Polygons.size();
-        i++)
-    {
-        polygon Polygon = Polygons[i];
-
-        switch(ClassifyPolygonToPlane(Polygon, SplitPlane))
-        {
-            case POLYGON_COPLANAR_WITH_PLANE:
-            {
-                Front.push_back(Polygon);
-            }break;
-            case POLYGON_IN_FRONT_OF_PLANE:
-            {
-                Front.push_back(Polygon);
-            } break;
-            case POLYGON_BEHIND_PLANE:
-            {
-                Back.push_back(Polygon);
-            } break;
-            case POLYGON_STRADDLING_PLANE:
-            {
-                SplitPolygon(Polygon, SplitPlane, Front, Back);
-            } break;
-        }
-    }
-
-    if(Tree->Front)
-    {
-        auto Ret = BSPInsertCreateBack1(Tree->Front, Front);
-        if(Ret) Result.insert(Result.end(), Ret->begin(), Ret->end());
-    }
-
-    if(Tree->Back)
-    {
-        auto Ret = BSPInsertCreateBack1(Tree->Back, Back);
-        if(Ret) Result.insert(Result.end(), Ret->begin(), Ret->end());
-    }
-    else
-    {
-        return Back;
-    }
-
-    return Result;
-}
-
-std::unique_ptr<bsp_node>
-BSPInsertCreateBack(std::unique_ptr<bsp_node>& Tree, const std::vector<polygon>& Polygons)
-{
-    if(Polygons.size() == 0) return nullptr;
-    if(!Tree) return nullptr;
-    std::vector<polygon> Front, Back;
-    std::unique_ptr<bsp_node> NewNode(new bsp_node);
-    vec4 SplitPlane = Tree->Plane;
-    NewNode->Plane = SplitPlane;
-
-    for(uint32_t i = 0;
-        i < Polygons.size();
-        i++)
-    {
-        polygon Polygon = Polygons[i];
-
-        switch(ClassifyPolygonToPlane(Polygon, SplitPlane))
-        {
-            case POLYGON_COPLANAR_WITH_PLANE:
-            {
-                Front.push_back(Polygon);
-            }break;
-            case POLYGON_IN_FRONT_OF_PLANE:
-            {
-                Front.push_back(Polygon);
-            } break;
-            case POLYGON_BEHIND_PLANE:
-            {
-                Back.push_back(Polygon);
-            } break;
-            case POLYGON_STRADDLING_PLANE:
-            {
-                SplitPolygon(Polygon, SplitPlane, Front, Back);
-            } break;
-        }
-    }
-
-    NewNode->Polygons.insert(NewNode->Polygons.end(), Back.begin(), Back.end());
-
-    if(Tree->Front)
-        NewNode->Front = BSPInsertCreateBack(Tree->Front, Front);
-    if(Tree->Back)
-        NewNode->Back = BSPInsertCreateBack(Tree->Back, Back);
-
-    return NewNode;
-}
-
-std::optional<std::vector<polygon>>
-BSPInsertCreateFront1(std::unique_ptr<bsp_node>& Tree, const std::vector<polygon>& Polygons)
-{
-    if(Polygons.size() == 0) return {};
-    if(!Tree) return {};
-
-    vec4 SplitPlane = Tree->Plane;
-    std::vector<polygon> Front, Back, Result;
-
-    for(uint32_t i = 0;
-        i < Polygons.size();
-        i++)
-    {
-        polygon Polygon = Polygons[i];
-
-        switch(ClassifyPolygonToPlane(Polygon, SplitPlane))
-        {
-            case POLYGON_COPLANAR_WITH_PLANE:
-            {
-                Front.push_back(Polygon);
-            }break;
-            case POLYGON_IN_FRONT_OF_PLANE:
-            {
-                Front.push_back(Polygon);
-            } break;
-            case POLYGON_BEHIND_PLANE:
-            {
-                Back.push_back(Polygon);
-            } break;
-            case POLYGON_STRADDLING_PLANE:
-            {
-                SplitPolygon(Polygon, SplitPlane, Front, Back);
-            } break;
-        }
-    }
-
-    if(Tree->Front)
-    {
-        auto Ret = BSPInsertCreateFront1(Tree->Front, Front);
-        if(Ret) Result.insert(Result.end(), Ret->begin(), Ret->end());
-    }
-
-    if(Tree->Back)
-    {
-        auto Ret = BSPInsertCreateFront1(Tree->Back, Back);
-        if(Ret) Result.insert(Result.end(), Ret->begin(), Ret->end());
-    }
-
-    Result.insert(Result.end(), Front.begin(), Front.end());
-
-    return Result;
-}
-
-std::unique_ptr<bsp_node>
-BSPInsertCreateFront(std::unique_ptr<bsp_node>& Tree, const std::vector<polygon>& Polygons)
-{
-    if(Polygons.size() == 0) return nullptr;
-    if(!Tree) return nullptr;
-    std::vector<polygon> Front, Back;
-    std::unique_ptr<bsp_node> NewNode(new bsp_node);
-    NewNode->Plane = Tree->Plane;
-
-    for(uint32_t i = 0;
-        i < Polygons.size();
-        i++)
-    {
-        vec4 SplitPlane = Tree->Plane;
-        polygon Polygon = Polygons[i];
-
-        switch(ClassifyPolygonToPlane(Polygon, SplitPlane))
-        {
-            case POLYGON_COPLANAR_WITH_PLANE:
-            {
-                Front.push_back(Polygon);
-            }break;
-            case POLYGON_IN_FRONT_OF_PLANE:
-            {
-                Front.push_back(Polygon);
-            } break;
-            case POLYGON_BEHIND_PLANE:
-            {
-                Back.push_back(Polygon);
-            } break;
-            case POLYGON_STRADDLING_PLANE:
-            {
-                SplitPolygon(Polygon, SplitPlane, Front, Back);
-            } break;
-        }
-    }
-    NewNode->Polygons.insert(NewNode->Polygons.end(), Front.begin(), Front.end());
-
-    if(Tree->Front)
-        NewNode->Front = BSPInsertCreateFront(Tree->Front, Front);
-    if(Tree->Back)
-        NewNode->Back = BSPInsertCreateFront(Tree->Back, Back);
-
-    return NewNode;
-}
-
-void BSPMerge(std::unique_ptr<bsp_node>& A, std::unique_ptr<bsp_node>& B)
-{
-    BSPInsert(A, B->Polygons);
-
-    if(B->Front)
-        BSPMerge(A, B->Front);
-    if(B->Back)
-        BSPMerge(A, B->Back);
-}
-
-uint32_t BSPGetIndexCount(const std::unique_ptr<bsp_node>& Tree)
-{
-    uint32_t Result = Tree->Polygons.size() * 3;
-
-    if(Tree->Front) Result += BSPGetIndexCount(Tree->Front);
-    if(Tree->Back)  Result += BSPGetIndexCount(Tree->Back);
-
-    return Result;
-}
-
-void BSPGenerateVertices(const std::unique_ptr<bsp_node>& Tree, mesh& Mesh)
-{
-    std::unordered_map<vertex, uint32_t> UniqueVertices;
-    uint32_t IndexCount = BSPGetIndexCount(Tree);
-    std::vector<uint32_t> Indices(IndexCount);
-
-    std::queue<bsp_node*> Queue;
-    Queue.push(Tree.get());
-
-    uint32_t VertexIndex = 0;
-    while(!Queue.empty())
-    {
-        bsp_node* Node = Queue.front();
-        Queue.pop();
-        for(polygon Poly : Node->Polygons)
-        {
-            uint32_t PolyIdx = 0;
-            vec4 PolyPlane = GetPlaneFromPolygon(Poly);
-            vec3 Normal = Mesh.Model.GetMat3() * PolyPlane.xyz;
-            for(vertex Vert : Poly.V)
-            {
-                vertex NewVert;
-                NewVert.Pos  = Vert.Pos;
-                NewVert.Norm = Poly.V[PolyIdx].Norm;
-                NewVert.Col  = Poly.V[PolyIdx++].Col;
-
-                if(UniqueVertices.count(NewVert) == 0)
-                {
-                    UniqueVertices[NewVert] = static_cast<uint32_t>(Mesh.Vertices.size());
-                    Mesh.Vertices.push_back(NewVert);
-                }
-
-                Indices[VertexIndex++] = UniqueVertices[NewVert];
-            }
-        }
-
-        if(Node->Front)
-            Queue.push(Node->Front.get());
-
-        if(Node->Back)
-            Queue.push(Node->Back.get());
-    }
-
-    Mesh.VertexIndices = Indices;
-}
-
-mesh
-BSPSubtract(std::unique_ptr<bsp_node>& ATree, std::unique_ptr<bsp_node>& BTree, std::vector<polygon> APolygons, std::vector<polygon> BPolygons)
-{
-    mesh Result = {};
-
-    std::queue<bsp_node*> Queue;
-
-    std::unique_ptr<bsp_node> A = BSPInsertCreateBack(BTree, APolygons);
-    std::vector<polygon> B = *BSPInsertCreateBack1(ATree, BPolygons);
-
-    std::unordered_map<vertex, uint32_t> UniqueVertices;
-    uint32_t IndexCount = BSPGetIndexCount(A) + B.size()*3;
-    std::vector<uint32_t> Indices(IndexCount);
-    uint32_t VertexIndex = 0;
-
-    Queue.push(A.get());
-    while(!Queue.empty())
-    {
-        bsp_node* Node = Queue.front();
-        Queue.pop();
-
-        for(polygon Poly : Node->Polygons)
-        {
-            for(int PolyIdx = 0;
-                PolyIdx < 3;
-                PolyIdx++)
-            {
-                vertex NewVert;
-                NewVert.Pos  = Poly.V[PolyIdx].Pos;
-                NewVert.Norm = Poly.V[PolyIdx].Norm;
-                NewVert.Col  = Poly.V[PolyIdx].Col;
-
-                if(UniqueVertices.count(NewVert) == 0)
-                {
-                    UniqueVertices[NewVert] = static_cast<uint32_t>(Result.Vertices.size());
-                    Result.Vertices.push_back(NewVert);
-                }
-
-                Indices[VertexIndex++] = UniqueVertices[NewVert];
-            }
-        }
-
-        if(Node->Front)
-            Queue.push(Node->Front.get());
-        if(Node->Back)
-            Queue.push(Node->Back.get());
-    }
-
-    for(polygon Poly : B)
-    {
-        for(int PolyIdx = 2;
-            PolyIdx >= 0;
-            PolyIdx--)
-        {
-            vertex NewVert;
-            NewVert.Pos  = Poly.V[PolyIdx].Pos;
-            NewVert.Norm = vec3(-Poly.V[PolyIdx].Norm.x, -Poly.V[PolyIdx].Norm.y, -Poly.V[PolyIdx].Norm.z);
-            NewVert.Col  = Poly.V[PolyIdx].Col;
-
-            if(UniqueVertices.count(NewVert) == 0)
-            {
-                UniqueVertices[NewVert] = static_cast<uint32_t>(Result.Vertices.size());
-                Result.Vertices.push_back(NewVert);
-            }
-
-            Indices[VertexIndex++] = UniqueVertices[NewVert];
-        }
-    }
-
-    Result.VertexIndices = Indices;
-    return Result;
-}
-
-mesh
-MeshSubtract(mesh& A, mesh& B)
-{
-    mesh Result;
-
-    std::vector<polygon> APolygons = A.GeneratePolygons(A.VertexIndices);
-    std::vector<polygon> BPolygons = B.GeneratePolygons(B.VertexIndices);
-
-    std::unique_ptr<bsp_node> ATree = BuildBSPTree(APolygons);
-    std::unique_ptr<bsp_node> BTree = BuildBSPTree(BPolygons);
-    Result = BSPSubtract(ATree, BTree, APolygons, BPolygons);
-
-    Result.Model = A.Model;
-    return Result;
-}
-
 std::string LoadShaderSource(std::string Path)
 {
     std::ifstream File;
@@ -969,11 +121,28 @@ OpenGLRenderWidget::
 OpenGLRenderWidget(QWidget* parent) :
     QOpenGLWidget(parent)
 {
+    BuildParams.Pool = &task_pool::Get();
+
     Cube.LoadMesh("..\\assets\\cube.obj");
     Cylinder.GenerateCylinder(4, 1.0f, 0.1f);
 
     Cube.SetNewTransform(vec3(0.5f, 0.2f, 0.5f), vec3(2, 0, 3.5f), vec3(0));
     Cylinder.SetNewTransform(vec3(1), vec3(-0.5, 0.5f, 1.5f), vec3(0));
+
+    ProfilerSetThreadName("gui");
+    QByteArray ProfileEnv = qgetenv("CSG_PROFILE");
+    if(ProfileEnv == "overlay") SetProfileOutput(profile_output_overlay);
+    else if(ProfileEnv == "log") SetProfileOutput(profile_output_log);
+
+    QByteArray TraceEnv = qgetenv("CSG_TRACE");
+    if(!TraceEnv.isEmpty() && !ProfilerStartTrace(TraceEnv.constData()))
+        qDebug("Could not open the trace file %s", TraceEnv.constData());
+}
+
+OpenGLRenderWidget::
+~OpenGLRenderWidget()
+{
+    ProfilerStopTrace();
 }
 
 void OpenGLRenderWidget::
@@ -989,51 +158,8 @@ initializeGL()
     glDepthFunc(GL_LESS);
     glEnable(GL_DEPTH_TEST);
 
-    // Cube
-    glGenVertexArrays(1, &CubeVertexObject);
-    glCreateBuffers(1, &CubeVertexBuffer);
-    glCreateBuffers(1, &CubeIndexBuffer);
-
-    glBindVertexArray(CubeVertexObject);
-
-    glBindBuffer(GL_ARRAY_BUFFER, CubeVertexBuffer);
-    glBufferData(GL_ARRAY_BUFFER, Cube.Vertices.size()*sizeof(vertex), Cube.Vertices.data(), GL_DYNAMIC_DRAW);
-
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, CubeIndexBuffer);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, Cube.VertexIndices.size()*sizeof(unsigned int), Cube.VertexIndices.data(), GL_DYNAMIC_DRAW);
-
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(vertex), (void*)offsetof(vertex, Pos));
-
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(vertex), (void*)offsetof(vertex, Norm));
-
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(vertex), (void*)offsetof(vertex, Col));
-
-    // Cylinder
-    glGenVertexArrays(1, &CylinderVertexObject);
-    glCreateBuffers(1, &CylinderVertexBuffer);
-    glCreateBuffers(1, &CylinderIndexBuffer);
-
-    glBindVertexArray(CylinderVertexObject);
-
-    glBindBuffer(GL_ARRAY_BUFFER, CylinderVertexBuffer);
-    glBufferData(GL_ARRAY_BUFFER, Cylinder.Vertices.size()*sizeof(vertex), Cylinder.Vertices.data(), GL_DYNAMIC_DRAW);
-
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, CylinderIndexBuffer);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, Cylinder.VertexIndices.size()*sizeof(unsigned int), Cylinder.VertexIndices.data(), GL_DYNAMIC_DRAW);
-
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(vertex), (void*)offsetof(vertex, Pos));
-
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(vertex), (void*)offsetof(vertex, Norm));
-
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(vertex), (void*)offsetof(vertex, Col));
-
-    glBindVertexArray(0);
+    CreateGLMesh(CubeGL);
+    CreateGLMesh(CylinderGL);
 
     Program = glCreateProgram();
 
@@ -1088,73 +214,143 @@ initializeGL()
     ViewMat = LookAt(CameraPos, TargetPoint, vec3(0, 1, 0));
 }
 
+// NOTE: buffers are made on the first upload, a vertex array without them draws nothing
 void OpenGLRenderWidget::
-paintGL()
+CreateGLMesh(gl_mesh& Mesh)
 {
-    mesh ModCube = {};
-    ModCube.Model = FirstStep ? Cube.Model : Identity();
-    mesh ModCylinder = {};
-    ModCylinder.Model = Cylinder.Model;
-    std::unique_ptr<bsp_node> CubeTree = BuildBSPTree(Cube.GeneratePolygons(Cube.VertexIndices));
-    std::unique_ptr<bsp_node> CylinderTree = BuildBSPTree(Cylinder.GeneratePolygons(Cylinder.VertexIndices));
+    glCreateVertexArrays(1, &Mesh.VertexArray);
 
-    AreCollided(Cube, Cylinder);
+    glEnableVertexArrayAttrib(Mesh.VertexArray, 0);
+    glVertexArrayAttribFormat(Mesh.VertexArray, 0, 4, GL_FLOAT, GL_FALSE, offsetof(vertex, Pos));
+    glVertexArrayAttribBinding(Mesh.VertexArray, 0, 0);
 
-    // NOTE: Maybe some optimizations on this check
-    if(BSPCollision(CubeTree, Cylinder))
+    glEnableVertexArrayAttrib(Mesh.VertexArray, 1);
+    glVertexArrayAttribFormat(Mesh.VertexArray, 1, 3, GL_FLOAT, GL_FALSE, offsetof(vertex, Norm));
+    glVertexArrayAttribBinding(Mesh.VertexArray, 1, 0);
+
+    glEnableVertexArrayAttrib(Mesh.VertexArray, 2);
+    glVertexArrayAttribFormat(Mesh.VertexArray, 2, 3, GL_FLOAT, GL_FALSE, offsetof(vertex, Col));
+    glVertexArrayAttribBinding(Mesh.VertexArray, 2, 0);
+}
+
+// NOTE: immutable storage can not be resized, so a mesh that does not fit gets new
+// buffers half again as large as it needs. Cuts grow the stock a bit at a time,
+// this way most of them are only a sub data write
+void OpenGLRenderWidget::
+UploadGLMesh(gl_mesh& Mesh, const std::shared_ptr<const mesh>& Source)
+{
+    if(Source == Mesh.Uploaded) return;
+    Mesh.Uploaded = Source;
+    Mesh.IndexCount = 0;
+    if(!Source) return;
+
+    GLsizeiptr VertexSize = Source->Vertices.size() * sizeof(vertex);
+    GLsizeiptr IndexSize = Source->VertexIndices.size() * sizeof(unsigned int);
+
+    if(VertexSize > Mesh.VertexCapacity)
     {
-        Cube.UpdateColor(vec3(0.25, 0.7, 0.35));
-        Cylinder.UpdateColor(vec3(0.8, 0.25, 0.35));
-
-        ModCube = MeshSubtract(Cube, Cylinder);
-        Cube.Vertices = ModCube.Vertices;
-        Cube.VertexIndices = ModCube.VertexIndices;
-        Cube.Model = Identity();
-
-        glBindBuffer(GL_ARRAY_BUFFER, CubeVertexBuffer);
-        glBufferData(GL_ARRAY_BUFFER, (int32_t)ModCube.Vertices.size() * sizeof(vertex), ModCube.Vertices.data(), GL_DYNAMIC_DRAW);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, CubeIndexBuffer);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, (int32_t)ModCube.VertexIndices.size() * sizeof(unsigned int), ModCube.VertexIndices.data(), GL_DYNAMIC_DRAW);
-
-        glBindBuffer(GL_ARRAY_BUFFER, CylinderVertexBuffer);
-        glBufferData(GL_ARRAY_BUFFER, (int32_t)ModCylinder.Vertices.size() * sizeof(vertex), ModCylinder.Vertices.data(), GL_DYNAMIC_DRAW);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, CylinderIndexBuffer);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, (int32_t)ModCylinder.VertexIndices.size() * sizeof(unsigned int), ModCylinder.VertexIndices.data(), GL_DYNAMIC_DRAW);
+        glDeleteBuffers(1, &Mesh.VertexBuffer);
+        Mesh.VertexCapacity = VertexSize + VertexSize / 2;
+        glCreateBuffers(1, &Mesh.VertexBuffer);
+        glNamedBufferStorage(Mesh.VertexBuffer, Mesh.VertexCapacity, nullptr, GL_DYNAMIC_STORAGE_BIT);
+        glVertexArrayVertexBuffer(Mesh.VertexArray, 0, Mesh.VertexBuffer, 0, sizeof(vertex));
+    }
+    if(IndexSize > Mesh.IndexCapacity)
+    {
+        glDeleteBuffers(1, &Mesh.IndexBuffer);
+        Mesh.IndexCapacity = IndexSize + IndexSize / 2;
+        glCreateBuffers(1, &Mesh.IndexBuffer);
+        glNamedBufferStorage(Mesh.IndexBuffer, Mesh.IndexCapacity, nullptr, GL_DYNAMIC_STORAGE_BIT);
+        glVertexArrayElementBuffer(Mesh.VertexArray, Mesh.IndexBuffer);
+    }
+
+    if(VertexSize) glNamedBufferSubData(Mesh.VertexBuffer, 0, VertexSize, Source->Vertices.data());
+    if(IndexSize) glNamedBufferSubData(Mesh.IndexBuffer, 0, IndexSize, Source->VertexIndices.data());
+    Mesh.IndexCount = (GLsizei)Source->VertexIndices.size();
+}
+
+void OpenGLRenderWidget::
+paintGL()
+{
+    ProfilerBeginFrame();
+
+    // NOTE: the CSG steps run on the worker. What is drawn is the last frame it finished,
+    // which can be some poses behind the ones that were sent
+    bool IsCubeChanged = Cube.GeometryVersion != SubmittedCubeVersion;
+    bool IsCylinderChanged = Cylinder.GeometryVersion != SubmittedCylinderVersion;
+    if(IsCubeChanged || IsCylinderChanged ||
+       (memcmp(Cube.Model.V, SubmittedCubeModel.V, sizeof(Cube.Model.V)) != 0) ||
+       (memcmp(Cylinder.Model.V, SubmittedCylinderModel.V, sizeof(Cylinder.Model.V)) != 0))
+    {
+        csg_job Job;
+        Job.StockModel = Cube.Model;
+        Job.ToolModel = Cylinder.Model;
+        if(SubmittedCylinderVersion != ~0ull) Job.ToolFromModel = SubmittedCylinderModel;
+        if(IsCubeChanged) Job.Stock = Cube;
+        if(IsCylinderChanged) Job.Tool = Cylinder;
+        Job.Params = BuildParams;
+        CSGWorker.Submit(std::move(Job));
+
+        SubmittedCubeVersion = Cube.GeometryVersion;
+        SubmittedCylinderVersion = Cylinder.GeometryVersion;
+        SubmittedCubeModel = Cube.Model;
+        SubmittedCylinderModel = Cylinder.Model;
     }
-    else
+
+    // NOTE: a mesh the worker did not change is the same object as in the frame before,
+    // so only the meshes of a new cut or a moved tool are uploaded
+    std::shared_ptr<const csg_frame> Frame = CSGWorker.GetLatestFrame();
     {
-        Cube.UpdateColor(vec3(0.25, 0.7, 0.35));
-        Cylinder.UpdateColor(vec3(0.25, 0.7, 0.35));
-        BSPGenerateVertices(CubeTree, ModCube);
-        BSPGenerateVertices(CylinderTree, ModCylinder);
-
-        glBindBuffer(GL_ARRAY_BUFFER, CubeVertexBuffer);
-        glBufferData(GL_ARRAY_BUFFER, (int32_t)ModCube.Vertices.size() * sizeof(vertex), ModCube.Vertices.data(), GL_DYNAMIC_DRAW);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, CubeIndexBuffer);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, (int32_t)ModCube.VertexIndices.size() * sizeof(unsigned int), ModCube.VertexIndices.data(), GL_DYNAMIC_DRAW);
-
-        glBindBuffer(GL_ARRAY_BUFFER, CylinderVertexBuffer);
-        glBufferData(GL_ARRAY_BUFFER, (int32_t)ModCylinder.Vertices.size() * sizeof(vertex), ModCylinder.Vertices.data(), GL_DYNAMIC_DRAW);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, CylinderIndexBuffer);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, (int32_t)ModCylinder.VertexIndices.size() * sizeof(unsigned int), ModCylinder.VertexIndices.data(), GL_DYNAMIC_DRAW);
+        PROFILE_SCOPE(profile_upload);
+
+        UploadGLMesh(CubeGL, Frame ? Frame->Stock : nullptr);
+        UploadGLMesh(CylinderGL, Frame ? Frame->Tool : nullptr);
     }
 
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    glUseProgram(Program);
+    {
+        PROFILE_SCOPE(profile_draw);
 
-    glUniform3fv(glGetUniformLocation(Program, "CamPos"), 1, (float*)&CameraPos.E);
-    glUniformMatrix4fv(glGetUniformLocation(Program, "Proj"), 1, GL_TRUE, (float*)&ProjMat.E);
-    glUniformMatrix4fv(glGetUniformLocation(Program, "View"), 1, GL_TRUE, (float*)&ViewMat.E);
+        // NOTE: the overlay is drawn with QPainter, which changes the GL state
+        glEnable(GL_DEPTH_TEST);
+        glDisable(GL_BLEND);
 
-    glBindVertexArray(CubeVertexObject);
-    glDrawElements(GL_TRIANGLES, (int32_t)ModCube.VertexIndices.size(), GL_UNSIGNED_INT, 0);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        glUseProgram(Program);
 
-    glBindVertexArray(CylinderVertexObject);
-    glDrawElements(GL_TRIANGLES, (int32_t)ModCylinder.VertexIndices.size(), GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
+        glUniform3fv(glGetUniformLocation(Program, "CamPos"), 1, (float*)&CameraPos.E);
+        glUniformMatrix4fv(glGetUniformLocation(Program, "Proj"), 1, GL_TRUE, (float*)&ProjMat.E);
+        glUniformMatrix4fv(glGetUniformLocation(Program, "View"), 1, GL_TRUE, (float*)&ViewMat.E);
+
+        for(const gl_mesh* Mesh : {&CubeGL, &CylinderGL})
+        {
+            if(Mesh->IndexCount == 0) continue;
+            glBindVertexArray(Mesh->VertexArray);
+            glDrawElements(GL_TRIANGLES, Mesh->IndexCount, GL_UNSIGNED_INT, 0);
+        }
+        glBindVertexArray(0);
+    }
 
     A += DeltaTime;
     FirstStep = false;
+
+    ProfilerEndFrame();
+    if(ProfileOutput != profile_output_none)
+    {
+        char Text[1024];
+        ProfilerFormatStats(Text, sizeof(Text));
+
+        if(ProfileOutput == profile_output_overlay)
+        {
+            QPainter Painter(this);
+            Painter.setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+            Painter.setPen(Qt::white);
+            Painter.drawText(rect().adjusted(8, 8, -8, -8), Qt::AlignLeft | Qt::AlignTop, QString::fromLatin1(Text));
+        }
+        else if(GlobalProfiler.FrameCount % PROFILE_HISTORY_SIZE == 0)
+        {
+            qDebug("%s", Text);
+        }
+    }
 }
 
 void OpenGLRenderWidget::
@@ -1178,6 +374,14 @@ MoveTo(vec3 NewPos, float V)
     CubeWasModified = true;
 }
 
+// NOTE: the profiler only runs while there is somewhere to show its stats or a trace
+void OpenGLRenderWidget::
+SetProfileOutput(profile_output Output)
+{
+    ProfileOutput = Output;
+    ProfilerSetEnabled((Output != profile_output_none) || GlobalProfiler.IsTracing.load());
+}
+
 void OpenGLRenderWidget::
 SetNewCamera(vec3 Transform)
 {
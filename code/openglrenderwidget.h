@@ -5,6 +5,8 @@
 #include <QOpenGLFunctions_4_5_core>
 #include <QTimer>
 #include <QDebug>
+#include <QPainter>
+#include <QFontDatabase>
 
 #include <fstream>
 #include <sstream>
@@ -13,36 +15,39 @@
 #include <queue>
 #include <unordered_set>
 #include <algorithm>
+#include <numeric>
+#include <random>
+#include <chrono>
 
 #include <cmath>
+#include <cstring>
 
 #include "mat_h.hpp"
-#include "mesh.h"
+#include "csg.h"
+#include "csgworker.h"
 
-enum bsp_bool
+// NOTE: where the stage times of the profiler go, set with the CSG_PROFILE
+// environment variable (overlay or log) or SetProfileOutput. Independent of
+// this, CSG_TRACE=path writes every stage of every frame to a trace file
+enum profile_output
 {
-    bsp_union,
-    bsp_not,
+    profile_output_none,
+    profile_output_overlay, // drawn over the scene every frame
+    profile_output_log,     // printed once per PROFILE_HISTORY_SIZE frames
 };
 
-enum bsp_position
+// NOTE: GPU copy of one mesh. The buffers have immutable storage, a mesh that fits is
+// written over the one before, a bigger one gets new buffers with room to grow.
+// Uploaded is the mesh the buffers hold, a frame with the same mesh uploads nothing
+struct gl_mesh
 {
-    POLYGON_COPLANAR_WITH_PLANE,
-    POLYGON_IN_FRONT_OF_PLANE,
-    POLYGON_BEHIND_PLANE,
-    POLYGON_STRADDLING_PLANE,
-
-    POINT_ON_PLANE,
-    POINT_IN_FRONT_OF_PLANE,
-    POINT_BEHIND_PLANE,
-};
-
-struct bsp_node
-{
-    vec4 Plane;
-    std::vector<polygon> Polygons;
-    std::unique_ptr<bsp_node> Front;
-    std::unique_ptr<bsp_node> Back;
+    GLuint VertexArray = 0;
+    GLuint VertexBuffer = 0;
+    GLuint IndexBuffer = 0;
+    GLsizeiptr VertexCapacity = 0;
+    GLsizeiptr IndexCapacity = 0;
+    GLsizei IndexCount = 0;
+    std::shared_ptr<const mesh> Uploaded;
 };
 
 class OpenGLRenderWidget : public QOpenGLWidget, public QOpenGLFunctions_4_5_Core
@@ -53,12 +58,8 @@ class OpenGLRenderWidget : public QOpenGLWidget, public QOpenGLFunctions_4_5_Cor
     float A = 0;
 
     GLuint Program;
-    GLuint CubeVertexBuffer;
-    GLuint CubeIndexBuffer;
-    GLuint CylinderVertexBuffer;
-    GLuint CylinderIndexBuffer;
-    GLuint CubeVertexObject;
-    GLuint CylinderVertexObject;
+    gl_mesh CubeGL;
+    gl_mesh CylinderGL;
 
     vec3 CameraPos = {0.1, 1, -1};
     mat4 ProjMat = Identity();
@@ -70,22 +71,39 @@ class OpenGLRenderWidget : public QOpenGLWidget, public QOpenGLFunctions_4_5_Cor
 
 public:
     OpenGLRenderWidget(QWidget* parent = nullptr);
+    ~OpenGLRenderWidget();
 
     void MoveTo(vec3 NewPos, float V);
     void SetNewCamera(vec3 Transform);
+    void SetProfileOutput(profile_output Output);
 
     mesh Cube;
     mesh Cylinder;
 
+    bsp_build_params BuildParams;
+
+    // NOTE: the stock and all CSG state live in the worker, these are
+    // the inputs it was last sent, a job is only sent when they changed
+    csg_worker CSGWorker;
+    uint64_t SubmittedCubeVersion = ~0ull;
+    uint64_t SubmittedCylinderVersion = ~0ull;
+    mat4 SubmittedCubeModel = {};
+    mat4 SubmittedCylinderModel = {};
+
     vec3 TargetPoint = vec3(0.5, 0,  2);
 
     bool CubeWasModified = false;
     bool FirstStep = true;
 
+    profile_output ProfileOutput = profile_output_none;
+
 protected:
     void initializeGL() override;
     void paintGL() override;
     void resizeGL(int w, int h) override;
+
+    void CreateGLMesh(gl_mesh& Mesh);
+    void UploadGLMesh(gl_mesh& Mesh, const std::shared_ptr<const mesh>& Source);
 };
 
 #endif // OPENGLRENDERWIDGET_H